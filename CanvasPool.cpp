@@ -0,0 +1,101 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include "TCanvas.h"
+#include "TFrame.h"
+#include "TList.h"
+#include "TPad.h"
+#include "CanvasPool.h"
+
+namespace {
+
+/**
+ * Clear a pad, keeping its subpads.
+ *
+ * Pads without subpads are cleared by ROOT. In a divided pad the other
+ * primitives (e.g. overall axis labels) are removed by hand, leaving the
+ * frame to the pad.
+ *
+ * @param pad The pad
+ */
+void clearPad(TVirtualPad* pad) {
+  TList* primitives = pad->GetListOfPrimitives();
+  std::vector<TObject*> objs;
+  bool divided = false;
+  TIter next(primitives);
+  while (TObject* obj = next()) {
+    objs.push_back(obj);
+    divided |= obj->InheritsFrom(TVirtualPad::Class());
+  }
+
+  if (!divided) {
+    pad->Clear();
+    return;
+  }
+
+  for (TObject* obj : objs) {
+    if (obj->InheritsFrom(TVirtualPad::Class())) {
+      clearPad(static_cast<TVirtualPad*>(obj));
+    }
+    else if (!obj->InheritsFrom(TFrame::Class())) {
+      primitives->Remove(obj);
+      if (obj->TestBit(kCanDelete)) {
+        delete obj;
+      }
+    }
+  }
+
+  pad->Modified();
+}
+
+}  // namespace
+
+
+CanvasPool::~CanvasPool() {
+  for (auto& it : shapes) {
+    delete it.first;
+  }
+}
+
+
+TCanvas* CanvasPool::create(int width, int height, int ncols, int nrows) {
+  static size_t serial = 0;
+  TCanvas* c = new TCanvas(Form("canvas%lu", serial++), "", width, height);
+  assert(c);
+  if (ncols > 0 && nrows > 0) {
+    c->Divide(ncols, nrows, 0, 0);
+  }
+  return c;
+}
+
+
+TCanvas* CanvasPool::get(int width, int height, int ncols, int nrows) {
+  Shape shape(width, height, ncols, nrows);
+  std::vector<TCanvas*>& free = idle[shape];
+  if (!free.empty()) {
+    TCanvas* c = free.back();
+    free.pop_back();
+    reused++;
+    return c;
+  }
+
+  TCanvas* c = create(width, height, ncols, nrows);
+  shapes[c] = shape;
+  created++;
+  return c;
+}
+
+
+void CanvasPool::release(TCanvas* c) {
+  auto it = shapes.find(c);
+  assert(it != shapes.end());
+  clearPad(c);
+  idle[it->second].push_back(c);
+}
+
+
+void CanvasPool::printStats() const {
+  std::cout << "Canvas pool: " << created << " created, " << reused
+            << " reused" << std::endl;
+}
+
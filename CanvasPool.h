@@ -0,0 +1,79 @@
+#ifndef __plotter_CanvasPool__
+#define __plotter_CanvasPool__
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+class TCanvas;
+
+/**
+ * @class CanvasPool
+ * @brief Reusable canvases, keyed by size and pad grid
+ *
+ * Creating a canvas, and dividing it into a grid of pads, is a noticeable
+ * part of the time to draw a plot. Canvases taken from the pool are handed
+ * back after saving, cleared but keeping their pad layout, and the next plot
+ * of the same shape reuses them.
+ *
+ * Each canvas gets a unique name, so ROOT never replaces one with another.
+ */
+class CanvasPool {
+public:
+  /** Constructor. */
+  CanvasPool() : created(0), reused(0) {}
+
+  /** Destructor, deletes the idle canvases. */
+  ~CanvasPool();
+
+  /**
+   * Get an empty canvas, creating it if none of this shape is idle.
+   *
+   * @param width Width in pixels
+   * @param height Height in pixels
+   * @param ncols Pad columns, 0 for an undivided canvas
+   * @param nrows Pad rows, 0 for an undivided canvas
+   * @returns The canvas, owned by the pool
+   */
+  TCanvas* get(int width, int height, int ncols=0, int nrows=0);
+
+  /**
+   * Return a canvas to the pool, clearing it for reuse.
+   *
+   * Drawn objects the pads own (kCanDelete) are deleted, the others are
+   * only removed. The pads of a divided canvas are kept.
+   *
+   * @param c A canvas from get()
+   */
+  void release(TCanvas* c);
+
+  /**
+   * Create a new canvas, not tracked by any pool.
+   *
+   * @param width Width in pixels
+   * @param height Height in pixels
+   * @param ncols Pad columns, 0 for an undivided canvas
+   * @param nrows Pad rows, 0 for an undivided canvas
+   * @returns The canvas, owned by the caller
+   */
+  static TCanvas* create(int width, int height, int ncols=0, int nrows=0);
+
+  /** Print reuse statistics. */
+  void printStats() const;
+
+public:
+  size_t created;  //!< Canvases created
+  size_t reused;  //!< Requests served by an idle canvas
+
+private:
+  CanvasPool(const CanvasPool&);
+  CanvasPool& operator=(const CanvasPool&);
+
+  typedef std::tuple<int, int, int, int> Shape;  //!< (width, height, ncols, nrows)
+
+  std::map<Shape, std::vector<TCanvas*> > idle;  //!< Canvases ready for reuse
+  std::map<TCanvas*, Shape> shapes;  //!< Shape of every canvas from get()
+};
+
+#endif  // __plotter_CanvasPool__
+
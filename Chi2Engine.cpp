@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "TH2.h"
+#include "Chi2Engine.h"
+#include "HistKernels.h"
+
+Generator::Chi2 Chi2Engine::compute(const std::string& sample, const Loader& load_cov,
+                                    const HistView<double>& data,
+                                    const HistView<double>& mc,
+                                    size_t offset, size_t stride) {
+  size_t n = data.size();
+  assert(mc.size() == n);
+
+  std::vector<double> d(n), m(n);
+  for (size_t i=0; i<n; i++) {
+    d[i] = data.content(i);
+    m[i] = mc.content(i);
+  }
+
+  Generator::Chi2 result;
+
+  // With the covariance: solve L y = r, chi2 = |y|^2
+  if (load_cov && n > 0) {
+    const std::vector<double>& l = getFactor(sample, load_cov, n, offset, stride);
+    if (!l.empty()) {
+      std::vector<double> y(n);
+      double chi2 = 0;
+      for (size_t i=0; i<n; i++) {
+        double s = d[i] - m[i];
+        const double* row = &l[i * n];
+        for (size_t j=0; j<i; j++) {
+          s -= row[j] * y[j];
+        }
+        y[i] = s / row[i];
+        chi2 += y[i] * y[i];
+      }
+      result.chi2 = chi2;
+      result.ndof = n;
+      return result;
+    }
+  }
+
+  // Diagonal, from the data errors
+  std::vector<double> e2(n);
+  result.ndof = 0;
+  for (size_t i=0; i<n; i++) {
+    double e = data.error(i);
+    e2[i] = e * e;
+    if (e2[i] > 0) result.ndof++;
+  }
+  result.chi2 = chi2Sum(d.data(), e2.data(), m.data(), n);
+
+  return result;
+}
+
+
+const std::vector<double>& Chi2Engine::getFactor(const std::string& sample, const Loader& load_cov,
+                                                 size_t n, size_t offset, size_t stride) {
+  std::string key = sample + "/" + std::to_string(n) + "/" +
+                    std::to_string(offset) + "/" + std::to_string(stride);
+
+  auto it = factors.find(key);
+  if (it != factors.end()) {
+    hits++;
+    lru.splice(lru.begin(), lru, it->second.lru);
+    return it->second.factor;
+  }
+
+  misses++;
+  lru.push_front(key);
+  Entry& e = factors[key];
+  e.lru = lru.begin();
+
+  // Gather the block, if the bins are inside the matrix
+  HistCache::Handle handle = load_cov();
+  const TH2* cov = dynamic_cast<const TH2*>(handle.get());
+  size_t last = offset + (n - 1) * stride;
+  if (cov && last < size_t(cov->GetNbinsX()) && last < size_t(cov->GetNbinsY())) {
+    e.factor.resize(n * n);
+    for (size_t i=0; i<n; i++) {
+      for (size_t j=0; j<=i; j++) {
+        e.factor[i * n + j] = cov->GetBinContent(offset + i * stride + 1,
+                                                 offset + j * stride + 1);
+      }
+    }
+
+    if (!cholesky(e.factor, n)) {
+      std::cerr << sample << ": Covariance is not positive definite, "
+                << "using the data errors" << std::endl;
+      e.factor.clear();
+    }
+  }
+
+  bytes += e.factor.size() * sizeof(double);
+  evict();
+
+  return e.factor;
+}
+
+
+bool Chi2Engine::cholesky(std::vector<double>& a, size_t n) {
+  // Right-looking: factor a diagonal block, solve the panel below it, then
+  // update the trailing matrix, a block of columns at a time
+  const size_t nb = 64;
+
+  for (size_t k=0; k<n; k+=nb) {
+    size_t kend = std::min(k + nb, n);
+
+    // Diagonal block
+    for (size_t j=k; j<kend; j++) {
+      double* rj = &a[j * n];
+      double diag = rj[j];
+      for (size_t p=k; p<j; p++) {
+        diag -= rj[p] * rj[p];
+      }
+      if (!(diag > 0)) return false;
+      diag = std::sqrt(diag);
+      rj[j] = diag;
+
+      for (size_t i=j+1; i<kend; i++) {
+        double* ri = &a[i * n];
+        double s = ri[j];
+        for (size_t p=k; p<j; p++) {
+          s -= ri[p] * rj[p];
+        }
+        ri[j] = s / diag;
+      }
+    }
+
+    // Panel: L21 = A21 L11^-T
+    for (size_t i=kend; i<n; i++) {
+      double* ri = &a[i * n];
+      for (size_t j=k; j<kend; j++) {
+        const double* rj = &a[j * n];
+        double s = ri[j];
+        for (size_t p=k; p<j; p++) {
+          s -= ri[p] * rj[p];
+        }
+        ri[j] = s / rj[j];
+      }
+    }
+
+    // Trailing update: A22 -= L21 L21^T, lower triangle only
+    for (size_t i=kend; i<n; i++) {
+      double* ri = &a[i * n];
+      for (size_t j=kend; j<=i; j++) {
+        const double* rj = &a[j * n];
+        double s = 0;
+        for (size_t p=k; p<kend; p++) {
+          s += ri[p] * rj[p];
+        }
+        ri[j] -= s;
+      }
+    }
+  }
+
+  return true;
+}
+
+
+void Chi2Engine::evict() {
+  // Always keep the most recent factor, even if it alone is over the limit
+  while (capacity > 0 && bytes > capacity && lru.size() > 1) {
+    auto it = factors.find(lru.back());
+    bytes -= it->second.factor.size() * sizeof(double);
+    factors.erase(it);
+    lru.pop_back();
+  }
+}
+
+
+void Chi2Engine::printStats() const {
+  std::cout << "Chi2 engine: " << hits << " hits, " << misses
+            << " misses, " << factors.size() << " factors ("
+            << (bytes >> 20) << " MB)" << std::endl;
+}
+
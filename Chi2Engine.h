@@ -0,0 +1,107 @@
+#ifndef __plotter_Chi2Engine__
+#define __plotter_Chi2Engine__
+
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Generator.h"
+#include "HistView.h"
+
+class TH2;
+
+/**
+ * @class Chi2Engine
+ * @brief Data/MC chi2 over any range of bins, with the sample covariance
+ *
+ * The nuiscomp summary only has one chi2 per sample, over all bins. This
+ * recomputes it for a subset: an x range, one slice of a 2D histogram, etc.
+ *
+ * With a covariance matrix, the chi2 is r^T C^-1 r for r = data - MC,
+ * restricted to the chosen bins. The Cholesky factor of that block of C is
+ * computed once, cached by sample and bin subset, and reused for every
+ * generator, since they are all compared to the same data; each chi2 is
+ * then a triangular solve. The matrix itself is only read on a cache miss.
+ * Without a covariance matrix (or if the block is not positive definite)
+ * the data errors are used, ignoring bins with zero error.
+ *
+ * Bins are selected as in HistView: bin k of the data and MC views is row
+ * and column offset + k * stride of the covariance matrix (from 0).
+ */
+class Chi2Engine {
+public:
+  /**
+   * Function to read the covariance matrix on a cache miss. The handle
+   * holds a TH2, or nothing to use the data errors.
+   */
+  typedef std::function<HistCache::Handle()> Loader;
+
+  /**
+   * Constructor.
+   *
+   * @param _capacity Approximate size limit of the cached factors in bytes,
+   *                  0 for no limit
+   */
+  Chi2Engine(size_t _capacity=0) : hits(0), misses(0), capacity(_capacity), bytes(0) {}
+
+  /**
+   * Compute a chi2.
+   *
+   * @param sample Sample name, the cache key for the covariance
+   * @param load_cov Covariance matrix loader, empty to use the data errors
+   * @param data Data bins
+   * @param mc MC bins, the same number as data
+   * @param offset Covariance index of the first bin
+   * @param stride Covariance index step between bins
+   * @returns chi2 and ndof
+   */
+  Generator::Chi2 compute(const std::string& sample, const Loader& load_cov,
+                          const HistView<double>& data, const HistView<double>& mc,
+                          size_t offset=0, size_t stride=1);
+
+  /** Print hit/miss statistics. */
+  void printStats() const;
+
+  /**
+   * Cholesky factorization in place, blocked for cache locality.
+   *
+   * @param a Symmetric n x n matrix, row major; on success the lower
+   *          triangle holds L with a = L L^T (the upper triangle is unused)
+   * @param n Matrix dimension
+   * @returns False if the matrix is not positive definite
+   */
+  static bool cholesky(std::vector<double>& a, size_t n);
+
+public:
+  size_t hits;  //!< Factors served from the cache
+  size_t misses;  //!< Factors computed
+
+private:
+  /** A cached factor. */
+  struct Entry {
+    std::vector<double> factor;  //!< Lower triangular L, row major; empty if C is unusable
+    std::list<std::string>::iterator lru;  //!< Position in the LRU list
+  };
+
+  /**
+   * Get the factor of a block of the covariance matrix, computing it if
+   * needed.
+   *
+   * @returns The factor, empty if the block is out of range or not positive
+   *          definite
+   */
+  const std::vector<double>& getFactor(const std::string& sample, const Loader& load_cov,
+                                       size_t n, size_t offset, size_t stride);
+
+  /** Drop least recently used factors until under the size limit. */
+  void evict();
+
+  size_t capacity;  //!< Size limit in bytes, 0 for none
+  size_t bytes;  //!< Approximate size of the cached factors
+  std::unordered_map<std::string, Entry> factors;  //!< Factors by sample and bins
+  std::list<std::string> lru;  //!< Keys, most recently used first
+};
+
+#endif  // __plotter_Chi2Engine__
+
@@ -0,0 +1,14 @@
+#include "json.hh"
+#include "ConfigBuilder.h"
+
+bool ConfigBuilder::complete(json::Value& value) {
+  // An element of the top-level object's plots array
+  if (getDepth() == 2 &&
+      getContainer(0).getType() == json::TOBJECT && isKey(0, "plots") &&
+      getContainer(1).getType() == json::TARRAY) {
+    on_plot(value);
+    return false;
+  }
+  return true;
+}
+
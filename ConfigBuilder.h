@@ -0,0 +1,40 @@
+#ifndef __plotter_ConfigBuilder__
+#define __plotter_ConfigBuilder__
+
+#include <functional>
+#include "json.hh"
+
+/**
+ * @class ConfigBuilder
+ * @brief Build the configuration while it is parsed, one plot at a time
+ *
+ * The top-level object is built as usual, except for the `plots` array:
+ * each plot's block is handed to a callback as soon as it has been parsed,
+ * and then dropped rather than added to the tree. Only the block being
+ * parsed is held in memory, however many plots there are.
+ *
+ * Use it with json::Reader::parse; the rest of the configuration is then
+ * in getResult(), with an empty `plots` array.
+ */
+class ConfigBuilder : public json::Builder {
+public:
+  /** Callback for each plot block, in config order. */
+  typedef std::function<void(json::Value&)> PlotHook;
+
+  /**
+   * Constructor.
+   *
+   * @param _on_plot Called with each plot block
+   */
+  ConfigBuilder(PlotHook _on_plot) : on_plot(_on_plot) {}
+
+protected:
+  /** Hand complete plot blocks to the callback, keep everything else. */
+  bool complete(json::Value& value) override;
+
+private:
+  PlotHook on_plot;  //!< Plot block callback
+};
+
+#endif  // __plotter_ConfigBuilder__
+
@@ -0,0 +1,49 @@
+#include <string>
+#include "TFile.h"
+#include "FilePool.h"
+
+FilePool::~FilePool() {
+  while (!lru.empty()) {
+    close(lru.back().first);
+  }
+}
+
+
+TFile* FilePool::get(const std::string& filename) {
+  // Already open: move to the front
+  auto it = index.find(filename);
+  if (it != index.end()) {
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->second;
+  }
+
+  // Make room, closing the least recently used files
+  while (capacity > 0 && lru.size() >= capacity) {
+    close(lru.back().first);
+  }
+
+  TFile* f = TFile::Open(filename.c_str());
+  if (!f || !f->IsOpen()) {
+    delete f;
+    return nullptr;
+  }
+
+  lru.emplace_front(filename, f);
+  index[filename] = lru.begin();
+
+  return f;
+}
+
+
+void FilePool::close(const std::string& filename) {
+  auto it = index.find(filename);
+  if (it == index.end()) return;
+
+  TFile* f = it->second->second;
+  lru.erase(it->second);
+  index.erase(it);
+
+  f->Close();
+  delete f;
+}
+
@@ -0,0 +1,66 @@
+#ifndef __plotter_FilePool__
+#define __plotter_FilePool__
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+class TFile;
+
+/**
+ * @class FilePool
+ * @brief A bounded LRU set of open ROOT files
+ *
+ * Files are opened on first use and closed when the pool is full and another
+ * file is needed, least recently used first. A closed file is reopened
+ * transparently the next time it is requested.
+ *
+ * A TFile* returned by get() is only guaranteed to stay open until the next
+ * call to get(), so callers should not hold on to it.
+ */
+class FilePool {
+public:
+  /**
+   * Constructor.
+   *
+   * @param _capacity Maximum number of open files, 0 for no limit
+   */
+  FilePool(size_t _capacity=0) : capacity(_capacity) {}
+
+  /** Destructor, closes all open files. */
+  ~FilePool();
+
+  /**
+   * Get an open file, opening it if necessary.
+   *
+   * @param filename Path to the ROOT file
+   * @returns The open file, or nullptr if it could not be opened
+   */
+  TFile* get(const std::string& filename);
+
+  /**
+   * Close a file, if it is open.
+   *
+   * @param filename Path to the ROOT file
+   */
+  void close(const std::string& filename);
+
+  /** Number of files currently open. */
+  size_t size() const { return lru.size(); }
+
+public:
+  size_t capacity;  //!< Maximum number of open files, 0 for no limit
+
+private:
+  FilePool(const FilePool&);
+  FilePool& operator=(const FilePool&);
+
+  typedef std::list<std::pair<std::string, TFile*> > FileList;
+
+  FileList lru;  //!< Open files, most recently used first
+  std::unordered_map<std::string, FileList::iterator> index;  //!< Lookup
+};
+
+#endif  // __plotter_FilePool__
+
@@ -0,0 +1,229 @@
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "TImage.h"
+#include "TVirtualPad.h"
+#include "Gallery.h"
+
+namespace {
+
+/** Escape text for HTML. */
+std::string escapeHtml(const std::string& s) {
+  std::string out;
+  for (char c : s) {
+    switch (c) {
+      case '&': out += "&amp;"; break;
+      case '<': out += "&lt;"; break;
+      case '>': out += "&gt;"; break;
+      case '"': out += "&quot;"; break;
+      default: out += c;
+    }
+  }
+  return out;
+}
+
+
+/** Split an absolute path into its components. */
+std::vector<std::string> splitPath(const std::string& path) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (start < path.size()) {
+    size_t end = path.find('/', start);
+    if (end == std::string::npos) end = path.size();
+    if (end > start) parts.push_back(path.substr(start, end - start));
+    start = end + 1;
+  }
+  return parts;
+}
+
+
+/**
+ * Path of a file relative to a directory.
+ *
+ * @param dir Existing directory
+ * @param path File path, absolute or relative to the working directory
+ */
+std::string relativeTo(const std::string& dir, const std::string& path) {
+  char buf[PATH_MAX];
+  if (!realpath(dir.c_str(), buf)) return path;
+  std::vector<std::string> from = splitPath(buf);
+
+  std::string abs = path;
+  if (path.empty() || path[0] != '/') {
+    if (!getcwd(buf, sizeof(buf))) return path;
+    abs = std::string(buf) + "/" + path;
+  }
+  std::vector<std::string> to = splitPath(abs);
+
+  size_t common = 0;
+  while (common < from.size() && common + 1 < to.size() && from[common] == to[common]) {
+    common++;
+  }
+
+  std::string rel;
+  for (size_t i=common; i<from.size(); i++) rel += "../";
+  for (size_t i=common; i<to.size(); i++) {
+    rel += to[i];
+    if (i + 1 < to.size()) rel += "/";
+  }
+  return rel;
+}
+
+}  // namespace
+
+
+Gallery::Gallery(const std::string& _dir) : dir(_dir) {
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    perror(("Gallery: " + dir).c_str());
+  }
+}
+
+
+std::string Gallery::thumbnailPath(const std::string& dir, const std::string& name) {
+  return dir + "/" + name + ".png";
+}
+
+
+bool Gallery::thumbnail(TVirtualPad* pad, const std::string& path, unsigned width) {
+  TImage* img = TImage::Create();
+  if (!img) return false;
+
+  img->FromPad(pad);
+  if (img->GetWidth() > 0) {
+    unsigned height = width * img->GetHeight() / img->GetWidth();
+    img->Scale(width, height);
+  }
+
+  // Write to a temporary file and rename, so a thumbnail is never partial
+  std::string tmp = path + ".tmp.png";
+  img->WriteImage(tmp.c_str(), TImage::kPng);
+  delete img;
+
+  if (rename(tmp.c_str(), path.c_str()) != 0) {
+    perror(("Gallery: " + path).c_str());
+    return false;
+  }
+  return true;
+}
+
+
+std::string Gallery::chi2Path(const std::string& dir, const std::string& name) {
+  return dir + "/" + name + ".chi2";
+}
+
+
+bool Gallery::writeChi2(const std::string& path,
+                        const std::vector<std::pair<std::string, std::string> >& chi2) {
+  // Write to a temporary file and rename, as for thumbnails
+  std::string tmp = path + ".tmp";
+  std::ofstream out(tmp.c_str());
+  for (auto& row : chi2) {
+    out << row.first << '\t' << row.second << '\n';
+  }
+  out.close();
+
+  if (!out || rename(tmp.c_str(), path.c_str()) != 0) {
+    perror(("Gallery: " + path).c_str());
+    return false;
+  }
+  return true;
+}
+
+
+bool Gallery::readChi2(const std::string& path,
+                       std::vector<std::pair<std::string, std::string> >& chi2) {
+  std::ifstream in(path.c_str());
+  if (!in) return false;
+
+  chi2.clear();
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t tab = line.rfind('\t');
+    if (tab == std::string::npos) continue;
+    chi2.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+  }
+  return true;
+}
+
+
+std::string Gallery::experiment(const std::string& sample) {
+  return sample.substr(0, sample.find('_'));
+}
+
+
+bool Gallery::write() const {
+  // Group by experiment, keeping config order within each group
+  std::map<std::string, std::vector<const Entry*> > groups;
+  for (const Entry& entry : entries) {
+    groups[experiment(entry.sample)].push_back(&entry);
+  }
+
+  std::string path = dir + "/index.html";
+  std::string tmp = path + ".tmp";
+  std::ofstream out(tmp.c_str());
+
+  out << "<!DOCTYPE html>\n"
+      << "<html>\n<head>\n<meta charset=\"utf-8\">\n<title>Tensions plots</title>\n"
+      << "<style>\n"
+      << "body { font-family: sans-serif; margin: 1em 2em; }\n"
+      << "nav a { margin-right: 1em; }\n"
+      << ".grid { display: flex; flex-wrap: wrap; gap: 1em; }\n"
+      << "figure { margin: 0; width: 320px; }\n"
+      << "figure img { width: 320px; border: 1px solid #ccc; }\n"
+      << "figcaption { font-size: 0.8em; }\n"
+      << "td { padding: 0 0.5em 0 0; }\n"
+      << "</style>\n</head>\n<body>\n"
+      << "<h1>Tensions plots</h1>\n<nav>\n";
+
+  for (auto& group : groups) {
+    std::string id = escapeHtml(group.first);
+    out << "<a href=\"#" << id << "\">" << id << " (" << group.second.size() << ")</a>\n";
+  }
+  out << "</nav>\n";
+
+  for (auto& group : groups) {
+    std::string id = escapeHtml(group.first);
+    out << "<h2 id=\"" << id << "\">" << id << "</h2>\n<div class=\"grid\">\n";
+
+    for (const Entry* entry : group.second) {
+      struct stat st;
+      std::string thumb = thumbnailPath(dir, entry->name);
+      std::string src = escapeHtml(entry->name + ".png");
+
+      out << "<figure>\n<a href=\"" << escapeHtml(relativeTo(dir, entry->link)) << "\">";
+      if (stat(thumb.c_str(), &st) == 0) {
+        out << "<img src=\"" << src << "\" loading=\"lazy\" alt=\""
+            << escapeHtml(entry->sample) << "\">";
+      }
+      else {
+        out << "(no thumbnail)";
+      }
+      out << "</a>\n<figcaption>" << escapeHtml(entry->name) << "\n<table>\n";
+
+      for (auto& row : entry->chi2) {
+        out << "<tr><td>" << escapeHtml(row.first) << "</td><td>"
+            << escapeHtml(row.second) << "</td></tr>\n";
+      }
+      out << "</table>\n</figcaption>\n</figure>\n";
+    }
+
+    out << "</div>\n";
+  }
+
+  out << "</body>\n</html>\n";
+  out.close();
+
+  if (!out || rename(tmp.c_str(), path.c_str()) != 0) {
+    perror(("Gallery: " + path).c_str());
+    return false;
+  }
+  return true;
+}
+
@@ -0,0 +1,117 @@
+#ifndef __plotter_Gallery__
+#define __plotter_Gallery__
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class TVirtualPad;
+
+/**
+ * @class Gallery
+ * @brief Static HTML gallery of plot thumbnails
+ *
+ * Thumbnails are small PNGs rasterized from each plot's canvas when it is
+ * saved, so they are made in the worker processes and only for plots that
+ * are redrawn. The index page is written at the end of the run, with the
+ * plots grouped by experiment (the sample name up to the first underscore)
+ * and a chi2/ndof table for each. The table shows the values in the plot's
+ * legend, which the workers record next to the thumbnails since they may
+ * cover only the displayed bins.
+ */
+class Gallery {
+public:
+  /**
+   * @struct Entry
+   * @brief A plot in the gallery
+   */
+  struct Entry {
+    std::string sample;  //!< NUISANCE sample name
+    std::string name;  //!< Output name, without extension
+    std::string link;  //!< Output file the thumbnail links to
+    std::vector<std::pair<std::string, std::string> > chi2;  //!< (Generator, chi2/ndof)
+  };
+
+  /**
+   * Constructor.
+   *
+   * @param _dir Gallery directory (created if needed)
+   */
+  Gallery(const std::string& _dir);
+
+  /**
+   * Add a plot to the index.
+   *
+   * @param entry The plot
+   */
+  void add(const Entry& entry) { entries.push_back(entry); }
+
+  /**
+   * Write index.html.
+   *
+   * @returns True on success
+   */
+  bool write() const;
+
+  /**
+   * Path of a plot's thumbnail.
+   *
+   * @param dir Gallery directory
+   * @param name Output name, without extension
+   */
+  static std::string thumbnailPath(const std::string& dir, const std::string& name);
+
+  /**
+   * Rasterize a drawn pad to a thumbnail.
+   *
+   * @param pad The pad
+   * @param path Output PNG path
+   * @param width Thumbnail width in pixels; the height keeps the aspect ratio
+   * @returns True on success
+   */
+  static bool thumbnail(TVirtualPad* pad, const std::string& path, unsigned width=320);
+
+  /**
+   * Path of a plot's chi2 record.
+   *
+   * @param dir Gallery directory
+   * @param name Output name, without extension
+   */
+  static std::string chi2Path(const std::string& dir, const std::string& name);
+
+  /**
+   * Write a plot's chi2 record, one "<generator>\t<chi2/ndof>" line each.
+   *
+   * @param path Record path
+   * @param chi2 (Generator, chi2/ndof) pairs
+   * @returns True on success
+   */
+  static bool writeChi2(const std::string& path,
+                        const std::vector<std::pair<std::string, std::string> >& chi2);
+
+  /**
+   * Read a plot's chi2 record.
+   *
+   * @param path Record path
+   * @param chi2 Filled with the (Generator, chi2/ndof) pairs
+   * @returns True if the record was read
+   */
+  static bool readChi2(const std::string& path,
+                       std::vector<std::pair<std::string, std::string> >& chi2);
+
+  /**
+   * Experiment name for a sample: everything before the first underscore.
+   *
+   * @param sample NUISANCE sample name
+   */
+  static std::string experiment(const std::string& sample);
+
+public:
+  std::string dir;  //!< Gallery directory
+
+private:
+  std::vector<Entry> entries;  //!< Plots, in config order
+};
+
+#endif  // __plotter_Gallery__
+
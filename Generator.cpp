@@ -1,44 +1,239 @@
 #include <algorithm>
 #include <cassert>
 #include <string>
+#include <unordered_set>
+#include <vector>
 #include "json.hh"
 #include "TFile.h"
 #include "TH1.h"
 #include "TH1D.h"
 #include "TH2D.h"
 #include "TH3D.h"
+#include "TFileCacheRead.h"
+#include "TDatime.h"
+#include "TKey.h"
 #include "TList.h"
 #include "TString.h"
+#include "FilePool.h"
+#include "Hash.h"
+#include "HistBundle.h"
 #include "Generator.h"
 
-Generator::Generator(json::Value& c) : Generator() {
+Generator::Generator(json::Value& c, FilePool* _files, HistCache* _cache)
+    : Generator() {
   // Get configuration settings
   title = c.getMember("title").getString();
-  color = c.isMember("color") ? c.getMember("color").getInteger() : kBlack;
-  std::string filename = c.getMember("filename").getString();
-  
-  // Load the ROOT file
-  tfile = TFile::Open(filename.c_str());
+  const json::Value* vcolor = c.findMember("color");
+  color = vcolor ? vcolor->getInteger() : kBlack;
+  filename = c.getMember("filename").getString();
+  files = _files;
+  cache = _cache;
+  assert(files && cache);
+
+  // Extract a list of keys for later checks, either from a histogram bundle
+  // or from the ROOT file
+  if (HistBundle::isBundle(filename)) {
+    bundle = new HistBundle(filename);
+    assert(bundle->isOpen());
+    keys = bundle->getKeys();
+  }
+  else {
+    TFile* tfile = getFile();
+    TList* tkeys = tfile->GetListOfKeys();
+    for (int i=0; i<tkeys->GetEntries(); i++) {
+      keys.push_back(tkeys->At(i)->GetName());
+    }
+  }
+  key_set.insert(keys.begin(), keys.end());
+  catalog = SampleCatalog(keys);
+
+  loadChi2Table();
+}
+
+
+Generator::~Generator() {
+  delete bundle;
+}
+
+
+TFile* Generator::getFile() {
+  TFile* tfile = files->get(filename);
   assert(tfile && tfile->IsOpen());
-  TList* tkeys = tfile->GetListOfKeys();
+  return tfile;
+}
+
 
-  // Extract a list of keys for later checks
-  for (int i=0; i<tkeys->GetEntries(); i++) {
-    keys.push_back(tkeys->At(i)->GetName());
+TH1* Generator::readObject(const std::string& key) {
+  if (bundle) {
+    return bundle->load(key);
+  }
+
+  // Get the object as a generic TH1, detached from the file so that it
+  // outlives it
+  TFile* tfile = getFile();
+  tfile->cd();
+  TH1* ht = (TH1*) tfile->Get(key.c_str());
+  if (ht) {
+    ht->SetDirectory(nullptr);
   }
+  return ht;
 }
 
 
-TH1* Generator::getHistogram(std::string key) {
+void Generator::loadChi2Table() {
+  // Read the summary histograms directly; they are only needed here. If they
+  // are missing the table stays empty, and getChi2String will complain.
+  if (!key_set.count("likelihood_hist") || !key_set.count("ndof_hist")) {
+    return;
+  }
+
+  TH1* hchi2 = readObject("likelihood_hist");
+  TH1* hndof = readObject("ndof_hist");
+  assert(hchi2 && hndof);
+
+  for (int i=1; i<hchi2->GetNbinsX()+1; i++) {
+    std::string binlabel = hchi2->GetXaxis()->GetBinLabel(i);
+    if (!binlabel.empty() && !chi2_table.count(binlabel)) {
+      chi2_table[binlabel].chi2 = hchi2->GetBinContent(i);
+    }
+  }
+
+  for (int i=1; i<hndof->GetNbinsX()+1; i++) {
+    std::string binlabel = hndof->GetXaxis()->GetBinLabel(i);
+    if (binlabel.empty()) continue;
+    Chi2& c = chi2_table[binlabel];
+    if (c.ndof < 0) {
+      c.ndof = hndof->GetBinContent(i);
+    }
+  }
+
+  delete hchi2;
+  delete hndof;
+}
+
+
+HistCache::Handle Generator::getShared(const std::string& key) {
   // Check if we actually have this object in the file
-  if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+  if (!key_set.count(key)) {
     return nullptr;
   }
 
-  // Get the object as a generic TH1
-  tfile->cd();
-  TH1* ht = (TH1*) tfile->Get(key.c_str());
-  assert(ht);
+  return cache->get(filename, key, [&]() {
+    TH1* ht = readObject(key);
+    assert(ht);
+    return ht;
+  });
+}
+
+
+void Generator::prefetch(const std::vector<std::string>& keys) {
+  // Collect the objects we still need to read
+  std::vector<std::string> needed;
+  std::unordered_set<std::string> seen;
+  for (const std::string& key : keys) {
+    if (key_set.count(key) && !seen.count(key) && !cache->contains(filename, key)) {
+      needed.push_back(key);
+      seen.insert(key);
+    }
+  }
+
+  if (needed.empty()) return;
+
+  // Bundles are memory-mapped, so there is no I/O to batch
+  if (bundle) {
+    for (const std::string& key : needed) {
+      getShared(key);
+    }
+    return;
+  }
+
+  // Find the on-disk location of each object, in file order
+  TFile* tfile = getFile();
+  std::vector<std::pair<TKey*, std::string> > tkeys;
+  for (const std::string& key : needed) {
+    TKey* tkey = tfile->FindKey(key.c_str());
+    if (tkey) tkeys.emplace_back(tkey, key);
+  }
+  std::sort(tkeys.begin(), tkeys.end(),
+            [](const std::pair<TKey*, std::string>& a,
+               const std::pair<TKey*, std::string>& b) {
+              return a.first->GetSeekKey() < b.first->GetSeekKey();
+            });
+
+  // Read in batches of up to 256 MB: register the byte ranges with a read
+  // cache, which fetches them all with one vectored read, then deserialize
+  const Long64_t max_batch = 256 * 1024 * 1024;
+  size_t first = 0;
+  while (first < tkeys.size()) {
+    size_t last = first;
+    Long64_t nbytes = 0;
+    while (last < tkeys.size() &&
+           (last == first || nbytes + tkeys[last].first->GetNbytes() <= max_batch)) {
+      nbytes += tkeys[last].first->GetNbytes();
+      last++;
+    }
+
+    TFileCacheRead* fcache = new TFileCacheRead(tfile, nbytes);
+    tfile->SetCacheRead(fcache);
+    for (size_t i=first; i<last; i++) {
+      fcache->Prefetch(tkeys[i].first->GetSeekKey(), tkeys[i].first->GetNbytes());
+    }
+
+    for (size_t i=first; i<last; i++) {
+      getShared(tkeys[i].second);
+    }
+
+    tfile->SetCacheRead(nullptr);
+    delete fcache;
+
+    first = last;
+  }
+}
+
+
+uint64_t Generator::getContentHash(const std::string& key) {
+  if (!key_set.count(key)) return 0;
+
+  auto it = content_hashes.find(key);
+  if (it != content_hashes.end()) {
+    return it->second;
+  }
+
+  // Hash the stored bytes of a bundle record, which are already mapped. For
+  // ROOT files, reading the object would cost a request per key on remote
+  // storage, so hash the key's metadata from the directory listing instead:
+  // rewriting the object changes its position, sizes or timestamp.
+  Hash hash;
+  if (bundle) {
+    const char* data;
+    size_t length;
+    if (bundle->getRecord(key, data, length)) {
+      hash.add(data, length);
+    }
+  }
+  else {
+    TFile* tfile = getFile();
+    TKey* tkey = tfile->FindKey(key.c_str());
+    if (tkey) {
+      hash.add(std::string(tkey->GetClassName()));
+      hash.add(uint64_t(tkey->GetSeekKey()));
+      hash.add(uint64_t(tkey->GetNbytes()));
+      hash.add(uint64_t(tkey->GetObjlen()));
+      hash.add(uint64_t(tkey->GetCycle()));
+      hash.add(uint64_t(tkey->GetDatime().Get()));
+    }
+  }
+
+  content_hashes[key] = hash.value;
+  return hash.value;
+}
+
+
+TH1* Generator::getHistogram(std::string key) {
+  HistCache::Handle ht = getShared(key);
+  if (!ht) {
+    return nullptr;
+  }
 
   // Clone the object as a TH(1|2|3)D, for ownership
   TH1* h =  nullptr;;
@@ -61,25 +256,26 @@ TH1* Generator::getHistogram(std::string key) {
 }
 
 
-std::string Generator::getChi2String(std::string sample) {
-  TH1D* hchi2 = (TH1D*) getHistogram("likelihood_hist");
-  TH1D* hndof = (TH1D*) getHistogram("ndof_hist");
-  assert(hchi2 && hndof);
+std::string Generator::getChi2String(const std::string& sample) const {
+  assert(!chi2_table.empty());
+  return formatChi2(getChi2(sample));
+}
+
+
+std::string Generator::formatChi2(const Chi2& c) {
   std::string chi2_str, ndof_str;
-  for (int i=0; i<hchi2->GetNbinsX()+1; i++) {
-    std::string binlabel = hchi2->GetXaxis()->GetBinLabel(i);
-    if (binlabel == sample) {
-      chi2_str = Form("%1.2f", hchi2->GetBinContent(i));
-      break;
-    }
+  if (c.chi2 >= 0) {
+    chi2_str = Form("%1.2f", c.chi2);
   }
-  for (int i=0; i<hndof->GetNbinsX()+1; i++) {
-    std::string binlabel = hndof->GetXaxis()->GetBinLabel(i);
-    if (binlabel == sample) {
-      ndof_str = Form("%1.0f", hndof->GetBinContent(i));
-      break;
-    }
+  if (c.ndof >= 0) {
+    ndof_str = Form("%1.0f", c.ndof);
   }
   return chi2_str + "/" + ndof_str;
 }
 
+
+Generator::Chi2 Generator::getChi2(const std::string& sample) const {
+  Chi2Table::const_iterator it = chi2_table.find(sample);
+  return it != chi2_table.end() ? it->second : Chi2();
+}
+
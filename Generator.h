@@ -2,9 +2,16 @@
 #define __plotter_Generator__
 
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "json.hh"
 #include "TColor.h"
+#include "HistCache.h"
+#include "SampleCatalog.h"
 
+class FilePool;
+class HistBundle;
 class TFile;
 class TH1;
 
@@ -14,39 +21,137 @@ class TH1;
  */
 class Generator {
 public:
+  /**
+   * @struct Chi2
+   * @brief Goodness of fit for one sample, from the nuiscomp summary
+   */
+  struct Chi2 {
+    /** Default ctor. */
+    Chi2() : chi2(-1), ndof(-1) {}
+
+    double chi2;  //!< chi2, -1 if not available
+    double ndof;  //!< Number of degrees of freedom, -1 if not available
+  };
+
+  /** Lookup table of sample name to chi2/ndof. */
+  typedef std::unordered_map<std::string, Chi2> Chi2Table;
+
   /** Default ctor. */
-  Generator() : color(kBlack) {}
+  Generator() : color(kBlack), files(nullptr), cache(nullptr), bundle(nullptr) {}
 
   /**
    * Constructor with a JSON configuration.
    *
    * @param c JSON configuration block
+   * @param _files Pool of open ROOT files
+   * @param _cache Shared histogram cache
    */
-  Generator(json::Value& c);
+  Generator(json::Value& c, FilePool* _files, HistCache* _cache);
+
+  /** Destructor. Files are owned by the FilePool. */
+  ~Generator();
 
   /**
    * Get a histogram object out of the file.
    *
+   * The caller owns the returned copy and is free to modify it.
+   *
    * @param key Name of the object
    * @returns Histogram as a generic TH1*
    */
   TH1* getHistogram(std::string key);
 
+  /**
+   * Get a shared, read-only histogram, without copying.
+   *
+   * @param key Name of the object
+   * @returns Shared histogram handle, null if not found
+   */
+  HistCache::Handle getShared(const std::string& key);
+
+  /**
+   * Load a set of objects into the histogram cache ahead of time.
+   *
+   * For ROOT files, the objects are fetched with batched (vectored) reads in
+   * file order rather than one request per key, which matters on high
+   * latency storage.
+   *
+   * @param keys Names of the objects
+   */
+  void prefetch(const std::vector<std::string>& keys);
+
+  /**
+   * Get a hash identifying an object's stored contents, without reading it
+   * from a ROOT file.
+   *
+   * For ROOT files this hashes the key's class, position, sizes, cycle and
+   * timestamp, which change whenever the object is rewritten; for bundles,
+   * the stored bytes.
+   *
+   * @param key Name of the object
+   * @returns The hash, or 0 if the object is not found
+   */
+  uint64_t getContentHash(const std::string& key);
+
   /**
    * Get the chi2/ndof as a string.
    *
    * @param key Name of the sample
    * @returns "chi2/ndof" as a string
    */
-  std::string getChi2String(std::string sample);
+  std::string getChi2String(const std::string& sample) const;
+
+  /**
+   * Format a chi2/ndof as a string, leaving out missing values.
+   *
+   * @param c chi2 and ndof
+   * @returns "chi2/ndof" as a string
+   */
+  static std::string formatChi2(const Chi2& c);
+
+  /**
+   * Get the chi2/ndof for a sample.
+   *
+   * @param sample Name of the sample
+   * @returns chi2 and ndof, -1 where not available
+   */
+  Chi2 getChi2(const std::string& sample) const;
+
+  /**
+   * Get the chi2/ndof for all samples.
+   *
+   * @returns Table of chi2/ndof, keyed by sample name
+   */
+  const Chi2Table& getChi2Table() const { return chi2_table; }
 
 public:
   std::string title;  //!< Generator display title
+  std::string filename;  //!< ROOT file or bundle (nuiscomp output)
   int color;  //!< Line color
   std::vector<std::string> keys;  //!< List of available keys
+  SampleCatalog catalog;  //!< Available objects, by sample
 
 private:
-  TFile* tfile;  //!< ROOT file (nuiscomp output)
+  /** Build the chi2/ndof table from the nuiscomp summary histograms. */
+  void loadChi2Table();
+
+  /** Get the open ROOT file, reopening it if needed. */
+  TFile* getFile();
+
+  /**
+   * Read an object from the bundle or ROOT file, bypassing the cache.
+   *
+   * @param key Name of the object
+   * @returns A detached histogram owned by the caller, or nullptr
+   */
+  TH1* readObject(const std::string& key);
+
+  FilePool* files;  //!< Pool of open ROOT files
+  HistCache* cache;  //!< Shared histogram cache
+  HistBundle* bundle;  //!< Histogram bundle, if reading from one
+  std::unordered_set<std::string> key_set;  //!< Available keys, for lookup
+  std::unordered_map<std::string, uint64_t> content_hashes;  //!< Hash cache
+  Chi2Table chi2_table;  //!< chi2/ndof by sample
 };
 
 #endif  // __plotter_Generator__
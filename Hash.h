@@ -0,0 +1,53 @@
+#ifndef __plotter_Hash__
+#define __plotter_Hash__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * @class Hash
+ * @brief Incremental 64-bit FNV-1a hash
+ *
+ * Stable across runs and platforms, so it can be used for names and
+ * fingerprints that are stored on disk.
+ */
+class Hash {
+public:
+  /** Default ctor. */
+  Hash() : value(14695981039346656037ULL) {}
+
+  /** Add raw bytes. */
+  Hash& add(const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i=0; i<size; i++) {
+      value ^= p[i];
+      value *= 1099511628211ULL;
+    }
+    return *this;
+  }
+
+  /** Add a string, length-prefixed so that consecutive strings are unambiguous. */
+  Hash& add(const std::string& s) {
+    add(uint64_t(s.size()));
+    return add(s.data(), s.size());
+  }
+
+  /** Add an integer. */
+  Hash& add(uint64_t v) {
+    return add(&v, sizeof(v));
+  }
+
+  /** The hash as a 16-digit hex string. */
+  std::string hex() const {
+    char s[17];
+    snprintf(s, sizeof(s), "%016llx", (unsigned long long) value);
+    return s;
+  }
+
+public:
+  uint64_t value;  //!< Current hash value
+};
+
+#endif  // __plotter_Hash__
+
@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "TFile.h"
+#include "TH1.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TH3D.h"
+#include "TKey.h"
+#include "TList.h"
+#include "HistBundle.h"
+
+namespace {
+
+const char kMagic[8] = { 'H', 'I', 'S', 'T', 'B', 'N', 'D', 'L' };
+
+/** Round up to a multiple of 8 bytes. */
+inline uint64_t align8(uint64_t n) {
+  return (n + 7) & ~uint64_t(7);
+}
+
+
+/**
+ * @class OutBuffer
+ * @brief Append-only byte buffer used to build records
+ */
+class OutBuffer {
+public:
+  template <typename T>
+  void put(T v) {
+    data.append(reinterpret_cast<const char*>(&v), sizeof(T));
+  }
+
+  void putArray(const std::vector<double>& v) {
+    data.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(double));
+  }
+
+  void putString(const std::string& s) {
+    put<uint32_t>(s.size());
+    data.append(s);
+    pad();
+  }
+
+  void pad() {
+    data.resize(align8(data.size()), '\0');
+  }
+
+  std::string data;  //!< Buffer contents
+};
+
+
+/**
+ * @class Cursor
+ * @brief Bounds-checked reader over a mapped record
+ *
+ * Reads past the end set the fail flag and return empty values.
+ */
+class Cursor {
+public:
+  Cursor(const char* _base, size_t _size, size_t _pos)
+      : base(_base), size(_size), pos(_pos), fail(_pos > _size) {}
+
+  template <typename T>
+  T get() {
+    T v = T();
+    if (check(sizeof(T))) {
+      memcpy(&v, base + pos, sizeof(T));
+      pos += sizeof(T);
+    }
+    return v;
+  }
+
+  /** Get a pointer into the mapping; the data are 8-byte aligned. */
+  const double* getArray(uint64_t n) {
+    if (n > size / sizeof(double) || !check(n * sizeof(double))) return nullptr;
+    const double* p = reinterpret_cast<const double*>(base + pos);
+    pos += n * sizeof(double);
+    return p;
+  }
+
+  std::string getString() {
+    uint32_t n = get<uint32_t>();
+    if (!check(n)) return "";
+    std::string s(base + pos, n);
+    pos = align8(pos + n);
+    return s;
+  }
+
+  bool check(size_t n) {
+    if (fail || n > size - pos) fail = true;
+    return !fail;
+  }
+
+  const char* base;  //!< Start of the mapping
+  size_t size;  //!< Size of the mapping
+  size_t pos;  //!< Current offset
+  bool fail;  //!< Did any read go out of bounds?
+};
+
+
+/** Serialize one histogram. */
+std::string encode(TH1* h) {
+  OutBuffer out;
+  int dim = h->GetDimension();
+  out.put<uint32_t>(dim);
+  out.put<uint32_t>(0);
+  out.putString(h->GetTitle());
+
+  TAxis* axes[3] = { h->GetXaxis(), h->GetYaxis(), h->GetZaxis() };
+  for (int i=0; i<dim; i++) {
+    TAxis* ax = axes[i];
+    int nbins = ax->GetNbins();
+
+    std::vector<std::pair<uint32_t, std::string> > labels;
+    if (ax->GetLabels()) {
+      for (int j=1; j<nbins+1; j++) {
+        std::string label = ax->GetBinLabel(j);
+        if (!label.empty()) labels.emplace_back(j, label);
+      }
+    }
+
+    std::vector<double> edges(nbins + 1);
+    for (int j=0; j<nbins+1; j++) {
+      edges[j] = ax->GetBinLowEdge(j + 1);
+    }
+
+    out.put<uint32_t>(nbins);
+    out.put<uint32_t>(labels.size());
+    out.putString(ax->GetTitle());
+    out.putArray(edges);
+    for (auto& label : labels) {
+      out.put<uint32_t>(label.first);
+      out.putString(label.second);
+    }
+  }
+
+  int ncells = h->GetNcells();
+  std::vector<double> contents(ncells), errors(ncells);
+  for (int i=0; i<ncells; i++) {
+    contents[i] = h->GetBinContent(i);
+    errors[i] = h->GetBinError(i);
+  }
+
+  out.put<uint64_t>(ncells);
+  out.put<double>(h->GetEntries());
+  out.putArray(contents);
+  out.putArray(errors);
+
+  return out.data;
+}
+
+}  // namespace
+
+
+HistBundle::HistBundle(const std::string& filename) : base(nullptr), size(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < 16) {
+    ::close(fd);
+    return;
+  }
+
+  void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) return;
+
+  base = static_cast<const char*>(p);
+  size = st.st_size;
+
+  // Check the header and read the index
+  Cursor c(base, size, 0);
+  bool ok = (memcmp(base, kMagic, sizeof(kMagic)) == 0);
+  c.pos = sizeof(kMagic);
+  ok = ok && (c.get<uint32_t>() == version);
+  uint32_t nentries = c.get<uint32_t>();
+
+  for (uint32_t i=0; ok && i<nentries; i++) {
+    uint64_t name_offset = c.get<uint64_t>();
+    uint64_t record_offset = c.get<uint64_t>();
+    uint32_t name_length = c.get<uint32_t>();
+    c.get<uint32_t>();
+
+    ok = (!c.fail && name_offset <= size && name_length <= size - name_offset &&
+          record_offset < size);
+    if (ok) {
+      std::string key(base + name_offset, name_length);
+      keys.push_back(key);
+      offsets[key] = record_offset;
+    }
+  }
+
+  // Records are contiguous, so each one ends where the next begins
+  std::vector<uint64_t> starts;
+  for (auto& it : offsets) starts.push_back(it.second);
+  std::sort(starts.begin(), starts.end());
+  for (size_t i=0; i<starts.size(); i++) {
+    lengths[starts[i]] = (i+1 < starts.size() ? starts[i+1] : size) - starts[i];
+  }
+
+  if (!ok || c.fail) {
+    munmap(const_cast<char*>(base), size);
+    base = nullptr;
+    size = 0;
+    keys.clear();
+    offsets.clear();
+    lengths.clear();
+  }
+}
+
+
+HistBundle::~HistBundle() {
+  if (base) {
+    munmap(const_cast<char*>(base), size);
+  }
+}
+
+
+TH1* HistBundle::load(const std::string& key) const {
+  auto it = offsets.find(key);
+  if (it == offsets.end()) return nullptr;
+
+  Cursor c(base, size, it->second);
+  uint32_t dim = c.get<uint32_t>();
+  c.get<uint32_t>();
+  std::string title = c.getString();
+  if (dim < 1 || dim > 3) return nullptr;
+
+  struct Axis {
+    uint32_t nbins;
+    std::string title;
+    const double* edges;
+    std::vector<std::pair<uint32_t, std::string> > labels;
+  } axes[3];
+
+  for (uint32_t i=0; i<dim; i++) {
+    axes[i].nbins = c.get<uint32_t>();
+    uint32_t nlabels = c.get<uint32_t>();
+    axes[i].title = c.getString();
+    axes[i].edges = c.getArray(uint64_t(axes[i].nbins) + 1);
+    for (uint32_t j=0; j<nlabels && !c.fail; j++) {
+      uint32_t bin = c.get<uint32_t>();
+      axes[i].labels.emplace_back(bin, c.getString());
+    }
+  }
+
+  uint64_t ncells = c.get<uint64_t>();
+  double entries = c.get<double>();
+  const double* contents = c.getArray(ncells);
+  const double* errors = c.getArray(ncells);
+  if (c.fail) return nullptr;
+
+  // Build the histogram without attaching it to the current directory
+  bool add_directory = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(false);
+
+  TH1* h = nullptr;
+  if (dim == 1) {
+    h = new TH1D(key.c_str(), title.c_str(), axes[0].nbins, axes[0].edges);
+  }
+  else if (dim == 2) {
+    h = new TH2D(key.c_str(), title.c_str(),
+                 axes[0].nbins, axes[0].edges, axes[1].nbins, axes[1].edges);
+  }
+  else {
+    h = new TH3D(key.c_str(), title.c_str(),
+                 axes[0].nbins, axes[0].edges, axes[1].nbins, axes[1].edges,
+                 axes[2].nbins, axes[2].edges);
+  }
+
+  TH1::AddDirectory(add_directory);
+
+  if (uint64_t(h->GetNcells()) != ncells) {
+    delete h;
+    return nullptr;
+  }
+
+  TAxis* haxes[3] = { h->GetXaxis(), h->GetYaxis(), h->GetZaxis() };
+  for (uint32_t i=0; i<dim; i++) {
+    haxes[i]->SetTitle(axes[i].title.c_str());
+    for (auto& label : axes[i].labels) {
+      haxes[i]->SetBinLabel(label.first, label.second.c_str());
+    }
+  }
+
+  h->Sumw2();
+  for (uint64_t i=0; i<ncells; i++) {
+    h->SetBinContent(i, contents[i]);
+    h->SetBinError(i, errors[i]);
+  }
+  h->SetEntries(entries);
+
+  return h;
+}
+
+
+bool HistBundle::getRecord(const std::string& key, const char*& data,
+                           size_t& length) const {
+  auto it = offsets.find(key);
+  if (it == offsets.end()) return false;
+
+  data = base + it->second;
+  length = lengths.at(it->second);
+  return true;
+}
+
+
+int HistBundle::write(TFile* tfile, const std::string& filename) {
+  // Serialize all histograms, taking the highest cycle of each key
+  std::vector<std::string> names, records;
+  std::unordered_set<std::string> seen;
+  TList* tkeys = tfile->GetListOfKeys();
+  for (int i=0; i<tkeys->GetEntries(); i++) {
+    TKey* tkey = (TKey*) tkeys->At(i);
+    std::string name = tkey->GetName();
+    if (seen.count(name)) continue;
+    seen.insert(name);
+
+    TObject* o = tkey->ReadObj();
+    TH1* h = dynamic_cast<TH1*>(o);
+    if (h && (h->IsA() == TH1D::Class() ||
+              h->IsA() == TH2D::Class() ||
+              h->IsA() == TH3D::Class())) {
+      names.push_back(name);
+      records.push_back(encode(h));
+    }
+    delete o;
+  }
+
+  // Lay out the header, index, names and records
+  OutBuffer out;
+  out.data.append(kMagic, sizeof(kMagic));
+  out.put<uint32_t>(version);
+  out.put<uint32_t>(names.size());
+
+  uint64_t name_offset = out.data.size() + 24 * names.size();
+  uint64_t record_offset = name_offset;
+  for (const std::string& name : names) {
+    record_offset += name.size();
+  }
+  record_offset = align8(record_offset);
+
+  for (size_t i=0; i<names.size(); i++) {
+    out.put<uint64_t>(name_offset);
+    out.put<uint64_t>(record_offset);
+    out.put<uint32_t>(names[i].size());
+    out.put<uint32_t>(0);
+    name_offset += names[i].size();
+    record_offset += records[i].size();
+  }
+
+  for (const std::string& name : names) {
+    out.data.append(name);
+  }
+  out.pad();
+
+  std::ofstream f(filename.c_str(), std::ios::binary);
+  f.write(out.data.data(), out.data.size());
+  for (const std::string& record : records) {
+    f.write(record.data(), record.size());
+  }
+  f.close();
+
+  return f ? (int) names.size() : -1;
+}
+
+
+bool HistBundle::isBundle(const std::string& filename) {
+  const std::string ext = ".hbundle";
+  return (filename.size() > ext.size() &&
+          filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0);
+}
+
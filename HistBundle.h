@@ -0,0 +1,103 @@
+#ifndef __plotter_HistBundle__
+#define __plotter_HistBundle__
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TFile;
+class TH1;
+
+/**
+ * @class HistBundle
+ * @brief A flat, memory-mapped file of histograms
+ *
+ * A bundle holds the TH1D, TH2D and TH3D objects from a nuiscomp file (bin
+ * edges, contents, errors, titles and bin labels) in a simple binary layout
+ * that can be read without ROOT I/O. Bundles are mapped read-only, so worker
+ * processes reading the same bundle share the page cache.
+ *
+ * Layout (native byte order, all sections 8-byte aligned):
+ *
+ *   Header   magic "HISTBNDL", uint32 version, uint32 number of entries
+ *   Index    per entry: uint64 name offset, uint64 record offset,
+ *            uint32 name length, uint32 reserved
+ *   Names    concatenated key names
+ *   Records  per histogram: uint32 dimension, uint32 reserved, title,
+ *            per axis (uint32 nbins, uint32 nlabels, title, double edges
+ *            [nbins+1], labels as (uint32 bin, string)), uint64 ncells,
+ *            double entries, double contents[ncells], double errors[ncells]
+ *
+ * Strings are stored as a uint32 length followed by the characters, padded
+ * to 8 bytes.
+ */
+class HistBundle {
+public:
+  /**
+   * Open a bundle.
+   *
+   * @param filename Path to the bundle file
+   */
+  HistBundle(const std::string& filename);
+
+  /** Destructor, unmaps the file. */
+  ~HistBundle();
+
+  /** Was the bundle opened and mapped successfully? */
+  bool isOpen() const { return base != nullptr; }
+
+  /** Names of all objects in the bundle, in file order. */
+  const std::vector<std::string>& getKeys() const { return keys; }
+
+  /**
+   * Build a histogram from the bundle.
+   *
+   * @param key Name of the object
+   * @returns A new, detached TH(1|2|3)D owned by the caller, or nullptr
+   */
+  TH1* load(const std::string& key) const;
+
+  /**
+   * Get the raw bytes of an object's record.
+   *
+   * @param key Name of the object
+   * @param data Set to the start of the record
+   * @param length Set to the length of the record
+   * @returns False if the object is not in the bundle
+   */
+  bool getRecord(const std::string& key, const char*& data, size_t& length) const;
+
+  /**
+   * Convert the histograms in a ROOT file into a bundle.
+   *
+   * Objects that are not a TH1D, TH2D or TH3D are skipped.
+   *
+   * @param tfile Input ROOT file
+   * @param filename Path to the output bundle
+   * @returns Number of histograms written, or -1 on error
+   */
+  static int write(TFile* tfile, const std::string& filename);
+
+  /**
+   * Check whether a path names a bundle (by extension, ".hbundle").
+   *
+   * @param filename Path to check
+   */
+  static bool isBundle(const std::string& filename);
+
+  static const uint32_t version = 1;  //!< Format version
+
+private:
+  HistBundle(const HistBundle&);
+  HistBundle& operator=(const HistBundle&);
+
+  const char* base;  //!< Start of the mapping
+  size_t size;  //!< Size of the mapping
+  std::vector<std::string> keys;  //!< Object names
+  std::unordered_map<std::string, uint64_t> offsets;  //!< Record offsets
+  std::unordered_map<uint64_t, uint64_t> lengths;  //!< Record lengths, by offset
+};
+
+#endif  // __plotter_HistBundle__
+
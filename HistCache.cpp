@@ -0,0 +1,71 @@
+#include <iostream>
+#include <string>
+#include "TH1.h"
+#include "HistCache.h"
+
+namespace {
+
+/** Cache key for an object. Keys cannot contain a newline, so this is unambiguous. */
+inline std::string makeId(const std::string& filename, const std::string& key) {
+  return filename + "\n" + key;
+}
+
+/** Approximate memory used by a histogram: bin contents and errors. */
+inline size_t histBytes(const TH1* h) {
+  size_t ncells = h->GetNcells();
+  return sizeof(double) * ncells * (h->GetSumw2N() > 0 ? 2 : 1);
+}
+
+}  // namespace
+
+
+HistCache::Handle HistCache::get(const std::string& filename,
+                                 const std::string& key, Loader load) {
+  std::string id = makeId(filename, key);
+
+  auto it = objects.find(id);
+  if (it != objects.end()) {
+    hits++;
+    lru.splice(lru.begin(), lru, it->second.lru);
+    return it->second.hist;
+  }
+
+  misses++;
+  Handle h(load());
+  if (h) {
+    lru.push_front(id);
+    Entry& e = objects[id];
+    e.hist = h;
+    e.bytes = histBytes(h.get());
+    e.lru = lru.begin();
+    bytes += e.bytes;
+    evict();
+  }
+
+  return h;
+}
+
+
+void HistCache::evict() {
+  // Always keep the most recent object, even if it alone is over the limit
+  while (capacity > 0 && bytes > capacity && lru.size() > 1) {
+    auto it = objects.find(lru.back());
+    bytes -= it->second.bytes;
+    objects.erase(it);
+    lru.pop_back();
+  }
+}
+
+
+bool HistCache::contains(const std::string& filename,
+                         const std::string& key) const {
+  return objects.count(makeId(filename, key)) > 0;
+}
+
+
+void HistCache::printStats() const {
+  std::cout << "Histogram cache: " << hits << " hits, " << misses
+            << " misses, " << objects.size() << " objects ("
+            << (bytes >> 20) << " MB)" << std::endl;
+}
+
@@ -0,0 +1,89 @@
+#ifndef __plotter_HistCache__
+#define __plotter_HistCache__
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class TH1;
+
+/**
+ * @class HistCache
+ * @brief Shared cache of histograms loaded from generator files
+ *
+ * Objects are keyed by (file, key), loaded once and never modified. They are
+ * handed out as shared read-only handles; anything that needs to modify a
+ * histogram (styling, scaling) must take its own copy, e.g. with
+ * Generator::getHistogram.
+ *
+ * The cache may be given a size limit, in which case the least recently used
+ * objects are dropped to stay under it. Handles that are still held elsewhere
+ * keep their objects alive; the cache just stops tracking them.
+ */
+class HistCache {
+public:
+  /** A shared, read-only histogram. */
+  typedef std::shared_ptr<const TH1> Handle;
+
+  /** Function to load an object on a cache miss, returns a detached TH1. */
+  typedef std::function<TH1*()> Loader;
+
+  /**
+   * Constructor.
+   *
+   * @param _capacity Approximate size limit in bytes, 0 for no limit
+   */
+  HistCache(size_t _capacity=0) : hits(0), misses(0), capacity(_capacity), bytes(0) {}
+
+  /**
+   * Get an object, loading it if it is not already cached.
+   *
+   * @param filename File containing the object
+   * @param key Name of the object
+   * @param load Function to load the object on a miss
+   * @returns Shared handle, null if the loader returns nullptr
+   */
+  Handle get(const std::string& filename, const std::string& key, Loader load);
+
+  /**
+   * Check whether an object is cached, without loading it.
+   *
+   * @param filename File containing the object
+   * @param key Name of the object
+   */
+  bool contains(const std::string& filename, const std::string& key) const;
+
+  /** Number of cached objects. */
+  size_t size() const { return objects.size(); }
+
+  /** Approximate size of the cached objects, in bytes. */
+  size_t getBytes() const { return bytes; }
+
+  /** Print hit/miss statistics. */
+  void printStats() const;
+
+public:
+  size_t hits;  //!< Lookups served from the cache
+  size_t misses;  //!< Lookups that required a load
+
+private:
+  /** A cached object. */
+  struct Entry {
+    Handle hist;  //!< The object
+    size_t bytes;  //!< Approximate size
+    std::list<std::string>::iterator lru;  //!< Position in the LRU list
+  };
+
+  /** Drop least recently used objects until under the size limit. */
+  void evict();
+
+  size_t capacity;  //!< Size limit in bytes, 0 for no limit
+  size_t bytes;  //!< Size of cached objects
+  std::list<std::string> lru;  //!< Object IDs, most recently used first
+  std::unordered_map<std::string, Entry> objects;  //!< Cached objects
+};
+
+#endif  // __plotter_HistCache__
+
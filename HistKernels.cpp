@@ -0,0 +1,148 @@
+#include <cmath>
+#include <cstddef>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "HistKernels.h"
+
+namespace {
+
+/** Error on a bin, from its squared error or its content. */
+inline double binError(const double* content, const double* error2, size_t i) {
+  return std::sqrt(error2 ? error2[i] : std::fabs(content[i]));
+}
+
+
+/**
+ * Scalar tail of binStats, continuing from partial results.
+ *
+ * @param content Bin contents
+ * @param error2 Squared bin errors, or nullptr
+ * @param begin First bin to include
+ * @param n Number of bins
+ * @param s Statistics so far, updated
+ */
+void binStatsScalar(const double* content, const double* error2,
+                    size_t begin, size_t n, BinStats& s) {
+  for (size_t i=begin; i<n; i++) {
+    double c = content[i];
+    if (c > s.max) {
+      s.max = c;
+      s.imax = i;
+    }
+    double v = c + binError(content, error2, i);
+    if (v > s.max_plus_error) s.max_plus_error = v;
+    s.integral += c;
+  }
+}
+
+}  // namespace
+
+
+BinStats binStats(const double* content, const double* error2, size_t n) {
+  BinStats s;
+  if (n == 0) return s;
+
+  s.max = content[0];
+  s.max_plus_error = content[0] + binError(content, error2, 0);
+  size_t i = 1;
+
+#ifdef __SSE2__
+  // Two lanes, each tracking its own first maximum, reduced at the end
+  if (n >= 4) {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d two = _mm_set1_pd(2);
+    __m128d vmax = _mm_loadu_pd(content);
+    __m128d vidx = _mm_set_pd(1, 0);
+    __m128d idx = vidx;
+    __m128d e2 = error2 ? _mm_loadu_pd(error2) : _mm_andnot_pd(sign, vmax);
+    __m128d vmpe = _mm_add_pd(vmax, _mm_sqrt_pd(e2));
+    __m128d vsum = vmax;
+
+    for (i=2; i+2<=n; i+=2) {
+      idx = _mm_add_pd(idx, two);
+      __m128d c = _mm_loadu_pd(content + i);
+      __m128d gt = _mm_cmpgt_pd(c, vmax);
+      vmax = _mm_or_pd(_mm_and_pd(gt, c), _mm_andnot_pd(gt, vmax));
+      vidx = _mm_or_pd(_mm_and_pd(gt, idx), _mm_andnot_pd(gt, vidx));
+
+      e2 = error2 ? _mm_loadu_pd(error2 + i) : _mm_andnot_pd(sign, c);
+      vmpe = _mm_max_pd(vmpe, _mm_add_pd(c, _mm_sqrt_pd(e2)));
+      vsum = _mm_add_pd(vsum, c);
+    }
+
+    double m[2], k[2], p[2], t[2];
+    _mm_storeu_pd(m, vmax);
+    _mm_storeu_pd(k, vidx);
+    _mm_storeu_pd(p, vmpe);
+    _mm_storeu_pd(t, vsum);
+
+    bool second = m[1] > m[0] || (m[1] == m[0] && k[1] < k[0]);
+    s.max = second ? m[1] : m[0];
+    s.imax = size_t(second ? k[1] : k[0]);
+    s.max_plus_error = p[0] > p[1] ? p[0] : p[1];
+    s.integral = t[0] + t[1];
+  }
+  else {
+    s.integral = content[0];
+  }
+#else
+  s.integral = content[0];
+#endif
+
+  binStatsScalar(content, error2, i, n, s);
+  s.max_error2 = error2 ? error2[s.imax] : std::fabs(s.max);
+  return s;
+}
+
+
+void scaleBins(double* content, double* error2, size_t n, double factor) {
+  double factor2 = factor * factor;
+  size_t i = 0;
+
+#ifdef __SSE2__
+  const __m128d f = _mm_set1_pd(factor);
+  const __m128d f2 = _mm_set1_pd(factor2);
+  for (; i+2<=n; i+=2) {
+    _mm_storeu_pd(content + i, _mm_mul_pd(_mm_loadu_pd(content + i), f));
+    if (error2) {
+      _mm_storeu_pd(error2 + i, _mm_mul_pd(_mm_loadu_pd(error2 + i), f2));
+    }
+  }
+#endif
+
+  for (; i<n; i++) {
+    content[i] *= factor;
+    if (error2) error2[i] *= factor2;
+  }
+}
+
+
+double chi2Sum(const double* data, const double* error2, const double* mc, size_t n) {
+  double chi2 = 0;
+  size_t i = 0;
+
+#ifdef __SSE2__
+  const __m128d zero = _mm_setzero_pd();
+  __m128d vsum = zero;
+  for (; i+2<=n; i+=2) {
+    __m128d e2 = _mm_loadu_pd(error2 + i);
+    __m128d d = _mm_sub_pd(_mm_loadu_pd(data + i), _mm_loadu_pd(mc + i));
+    __m128d term = _mm_div_pd(_mm_mul_pd(d, d), e2);
+    vsum = _mm_add_pd(vsum, _mm_and_pd(_mm_cmpgt_pd(e2, zero), term));
+  }
+  double t[2];
+  _mm_storeu_pd(t, vsum);
+  chi2 = t[0] + t[1];
+#endif
+
+  for (; i<n; i++) {
+    if (error2[i] > 0) {
+      double d = data[i] - mc[i];
+      chi2 += d * d / error2[i];
+    }
+  }
+
+  return chi2;
+}
+
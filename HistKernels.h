@@ -0,0 +1,64 @@
+#ifndef __plotter_HistKernels__
+#define __plotter_HistKernels__
+
+#include <cstddef>
+
+/**
+ * Bin kernels on contiguous arrays.
+ *
+ * These are the inner loops behind the y range, scaling and chi2 logic,
+ * written against plain arrays (e.g. a TH1D's contents and Sumw2) rather
+ * than per-bin virtual calls. They use SSE2 where the compiler provides it
+ * and plain loops otherwise; both give the same results up to the order of
+ * floating point additions.
+ *
+ * Errors are passed squared, as in ROOT's Sumw2 array. A null error array
+ * means Poisson errors, sqrt(|content|).
+ */
+
+/**
+ * @struct BinStats
+ * @brief Summary of a range of bins, gathered in one pass
+ */
+struct BinStats {
+  BinStats() : imax(0), max(0), max_error2(0), max_plus_error(0), integral(0) {}
+  size_t imax;  //!< Index of the largest content (first, if tied)
+  double max;  //!< Largest content
+  double max_error2;  //!< Squared error of bin imax
+  double max_plus_error;  //!< Largest content + error
+  double integral;  //!< Sum of contents
+};
+
+/**
+ * Compute the summary statistics of a set of bins.
+ *
+ * @param content Bin contents
+ * @param error2 Squared bin errors, or nullptr for Poisson errors
+ * @param n Number of bins
+ * @returns Statistics; all zero if n is 0
+ */
+BinStats binStats(const double* content, const double* error2, size_t n);
+
+/**
+ * Scale bins in place: contents by factor, squared errors by factor^2.
+ *
+ * @param content Bin contents
+ * @param error2 Squared bin errors, or nullptr
+ * @param n Number of bins
+ * @param factor Scale factor
+ */
+void scaleBins(double* content, double* error2, size_t n, double factor);
+
+/**
+ * Diagonal chi2, sum of (data - mc)^2 / error2 over bins with error2 > 0.
+ *
+ * @param data Data contents
+ * @param error2 Squared data errors
+ * @param mc Prediction
+ * @param n Number of bins
+ * @returns The chi2
+ */
+double chi2Sum(const double* data, const double* error2, const double* mc, size_t n);
+
+#endif  // __plotter_HistKernels__
+
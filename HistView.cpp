@@ -0,0 +1,96 @@
+#include <string>
+#include "TAxis.h"
+#include "TH1.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "HistView.h"
+
+namespace {
+
+/** Build a view along one axis of a histogram's flat arrays. */
+HistView<double> makeAxisView(const TH1* h, const TArrayD* array,
+                              const TAxis* axis, size_t offset, size_t stride) {
+  const TArrayD* sumw2 = h->GetSumw2();
+  const TArrayD* xbins = axis->GetXbins();
+  const double* errors = (sumw2->GetSize() > 0 ? sumw2->GetArray() + offset : nullptr);
+
+  return HistView<double>(axis->GetNbins(),
+                          xbins->GetSize() > 0 ? xbins->GetArray() : nullptr,
+                          axis->GetXmin(), axis->GetXmax(),
+                          array->GetArray() + offset, errors, stride,
+                          HistView<double>::kSquaredErrors);
+}
+
+}  // namespace
+
+
+HistView<double> makeView(const TH1D* h) {
+  return makeAxisView(h, h, h->GetXaxis(), 1, 1);
+}
+
+
+HistView<double> makeViewX(const TH2D* h, int ybin) {
+  size_t nx = h->GetNbinsX() + 2;
+  return makeAxisView(h, h, h->GetXaxis(), nx * ybin + 1, 1);
+}
+
+
+HistView<double> makeViewY(const TH2D* h, int xbin) {
+  size_t nx = h->GetNbinsX() + 2;
+  return makeAxisView(h, h, h->GetYaxis(), nx + xbin, nx);
+}
+
+
+template <>
+BinStats HistView<double>::stats() const {
+  if (stride != 1 || error_mode == kErrors) {
+    return statsLoop();
+  }
+  return binStats(contents, error_mode == kSquaredErrors ? errors : nullptr, nbins);
+}
+
+
+void scaleHist(TH1D* h, double factor) {
+  // As TH1::Scale: errors are kept from before the scaling
+  if (h->GetSumw2N() == 0) {
+    h->Sumw2();
+  }
+
+  double stats[TH1::kNstat];
+  h->GetStats(stats);
+
+  scaleBins(h->GetArray(), h->GetSumw2()->GetArray(), h->GetNcells(), factor);
+
+  stats[0] *= factor;
+  stats[1] *= factor * factor;
+  for (int i=2; i<TH1::kNstat; i++) {
+    stats[i] *= factor;
+  }
+  h->PutStats(stats);
+}
+
+
+TH1D* makeTH1D(const HistView<double>& v, const std::string& name) {
+  bool add_directory = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(false);
+
+  TH1D* h;
+  if (v.edges) {
+    h = new TH1D(name.c_str(), "", v.size(), v.edges);
+  }
+  else {
+    h = new TH1D(name.c_str(), "", v.size(), v.xmin, v.xmax);
+  }
+
+  TH1::AddDirectory(add_directory);
+
+  h->Sumw2();
+  for (size_t i=0; i<v.size(); i++) {
+    h->SetBinContent(i+1, v.content(i));
+    h->SetBinError(i+1, v.error(i));
+  }
+  h->ResetStats();
+
+  return h;
+}
+
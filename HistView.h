@@ -0,0 +1,216 @@
+#ifndef __plotter_HistView__
+#define __plotter_HistView__
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include "HistKernels.h"
+
+class TH1D;
+class TH2D;
+
+/**
+ * @class HistView
+ * @brief Non-owning, read-only view of the bins of a 1D histogram
+ *
+ * A view points at contiguous (optionally strided) arrays of bin contents
+ * and errors owned by something else, e.g. a cached TH1D or one row or column
+ * of a TH2D. It is only valid while that owner is alive and unmodified.
+ * Bins are indexed from 0 and do not include under/overflow.
+ *
+ * Errors may be stored directly, as squared errors (like ROOT's Sumw2
+ * array), or not at all, in which case they are sqrt(|content|).
+ *
+ * @tparam T Storage type for contents and errors (float or double)
+ */
+template <typename T>
+class HistView {
+public:
+  /** Error storage conventions. */
+  enum ErrorMode { kErrors, kSquaredErrors, kPoisson };
+
+  /** Default ctor, an empty view. */
+  HistView()
+      : nbins(0), edges(nullptr), xmin(0), xmax(0), contents(nullptr),
+        errors(nullptr), stride(1), error_mode(kPoisson) {}
+
+  /**
+   * Constructor with explicit arrays.
+   *
+   * @param _nbins Number of bins
+   * @param _edges Bin edges (nbins+1), or nullptr for uniform bins
+   * @param _xmin Lower edge, for uniform bins
+   * @param _xmax Upper edge, for uniform bins
+   * @param _contents Bin contents
+   * @param _errors Bin errors, or nullptr for Poisson errors
+   * @param _stride Distance between consecutive bins in the arrays
+   * @param _error_mode How errors are stored
+   */
+  HistView(size_t _nbins, const double* _edges, double _xmin, double _xmax,
+           const T* _contents, const T* _errors, size_t _stride=1,
+           ErrorMode _error_mode=kErrors)
+      : nbins(_nbins), edges(_edges), xmin(_xmin), xmax(_xmax),
+        contents(_contents), errors(_errors), stride(_stride),
+        error_mode(_errors ? _error_mode : kPoisson) {}
+
+  /** Number of bins. */
+  size_t size() const { return nbins; }
+
+  /** Content of bin i. */
+  T content(size_t i) const { return contents[i * stride]; }
+
+  /** Error on bin i. */
+  T error(size_t i) const {
+    switch (error_mode) {
+      case kErrors: return errors[i * stride];
+      case kSquaredErrors: return std::sqrt(errors[i * stride]);
+      default: return std::sqrt(std::fabs(contents[i * stride]));
+    }
+  }
+
+  /** Lower edge of bin i. */
+  double lowEdge(size_t i) const {
+    return edges ? edges[i] : xmin + (xmax - xmin) * i / nbins;
+  }
+
+  /** Upper edge of bin i. */
+  double upEdge(size_t i) const { return lowEdge(i + 1); }
+
+  /**
+   * Restrict the view to a range of bins.
+   *
+   * @param begin First bin
+   * @param end One past the last bin
+   * @returns A view of bins [begin, end)
+   */
+  HistView range(size_t begin, size_t end) const {
+    HistView v(*this);
+    v.nbins = end - begin;
+    v.contents = contents + begin * stride;
+    if (errors) v.errors = errors + begin * stride;
+    if (edges) {
+      v.edges = edges + begin;
+    }
+    else {
+      v.xmin = lowEdge(begin);
+      v.xmax = lowEdge(end);
+    }
+    return v;
+  }
+
+  /** Index of the bin with the largest content (first, if tied). */
+  size_t maximumBin() const {
+    size_t imax = 0;
+    for (size_t i=1; i<nbins; i++) {
+      if (content(i) > content(imax)) imax = i;
+    }
+    return imax;
+  }
+
+  /** Largest bin content. */
+  T maximum() const { return nbins ? content(maximumBin()) : T(0); }
+
+  /** Largest content + error over all bins. */
+  T maxContentPlusError() const {
+    T m = nbins ? content(0) + error(0) : T(0);
+    for (size_t i=1; i<nbins; i++) {
+      T v = content(i) + error(i);
+      if (v > m) m = v;
+    }
+    return m;
+  }
+
+  /**
+   * Summary statistics (maximum, error at the maximum, largest content +
+   * error, integral) in one pass. Contiguous double views with squared or
+   * Poisson errors use the vectorized kernel.
+   */
+  BinStats stats() const { return statsLoop(); }
+
+public:
+  size_t nbins;  //!< Number of bins
+  const double* edges;  //!< Bin edges, nullptr for uniform binning
+  double xmin;  //!< Lower edge (uniform binning)
+  double xmax;  //!< Upper edge (uniform binning)
+  const T* contents;  //!< Bin contents
+  const T* errors;  //!< Bin errors (see error_mode)
+  size_t stride;  //!< Array stride between bins
+  ErrorMode error_mode;  //!< How errors are stored
+
+private:
+  /** Bin by bin implementation of stats(), for any layout. */
+  BinStats statsLoop() const;
+};
+
+
+template <typename T>
+BinStats HistView<T>::statsLoop() const {
+  BinStats s;
+  for (size_t i=0; i<nbins; i++) {
+    T c = content(i);
+    if (i == 0 || c > s.max) {
+      s.max = c;
+      s.imax = i;
+    }
+    T v = c + error(i);
+    if (i == 0 || v > s.max_plus_error) s.max_plus_error = v;
+    s.integral += c;
+  }
+  if (nbins > 0) {
+    T e = error(s.imax);
+    s.max_error2 = e * e;
+  }
+  return s;
+}
+
+
+/** Contiguous double bins go to the kernel. */
+template <>
+BinStats HistView<double>::stats() const;
+
+
+/**
+ * View the bins of a TH1D.
+ *
+ * @param h The histogram
+ * @returns View of bins 1..N
+ */
+HistView<double> makeView(const TH1D* h);
+
+/**
+ * View a slice of a TH2D along x, at fixed y (like ProjectionX for one bin).
+ *
+ * @param h The histogram
+ * @param ybin The y bin, starting at 1
+ * @returns View of x bins 1..N
+ */
+HistView<double> makeViewX(const TH2D* h, int ybin);
+
+/**
+ * View a slice of a TH2D along y, at fixed x (like ProjectionY for one bin).
+ *
+ * @param h The histogram
+ * @param xbin The x bin, starting at 1
+ * @returns View of y bins 1..N
+ */
+HistView<double> makeViewY(const TH2D* h, int xbin);
+
+/**
+ * Scale a TH1D in place, like TH1::Scale but with the bin kernel.
+ *
+ * @param h The histogram
+ * @param factor Scale factor
+ */
+void scaleHist(TH1D* h, double factor);
+
+/**
+ * Build a TH1D from a view. This is where a ROOT object is materialized.
+ *
+ * @param v The view
+ * @param name Name for the new histogram
+ * @returns A new detached TH1D, owned by the caller
+ */
+TH1D* makeTH1D(const HistView<double>& v, const std::string& name);
+
+#endif  // __plotter_HistView__
+
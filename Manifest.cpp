@@ -0,0 +1,71 @@
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Manifest.h"
+
+const char* Manifest::version = "tensions-plots-1";
+
+Manifest::Manifest(const std::string& _filename) : filename(_filename) {
+  load();
+}
+
+
+void Manifest::load() {
+  entries.clear();
+  std::ifstream f(filename.c_str());
+  std::string output, fingerprint;
+  while (f >> output >> fingerprint) {
+    entries[output] = fingerprint;
+  }
+}
+
+
+bool Manifest::isCurrent(const std::string& output,
+                         const std::string& fingerprint) const {
+  auto it = entries.find(output);
+  return (it != entries.end() && it->second == fingerprint);
+}
+
+
+void Manifest::record(const std::string& output, const std::string& fingerprint) {
+  // One write per entry on an O_APPEND descriptor, so entries from concurrent
+  // workers do not interleave
+  std::string line = output + " " + fingerprint + "\n";
+  int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    perror(("Manifest: " + filename).c_str());
+    return;
+  }
+
+  ssize_t n;
+  do {
+    n = write(fd, line.data(), line.size());
+  } while (n < 0 && errno == EINTR);
+  close(fd);
+
+  entries[output] = fingerprint;
+}
+
+
+void Manifest::compact() {
+  load();
+
+  // Sorted, for a stable file
+  std::map<std::string, std::string> sorted(entries.begin(), entries.end());
+
+  std::string tmp = filename + ".tmp";
+  std::ofstream f(tmp.c_str());
+  for (auto& it : sorted) {
+    f << it.first << " " << it.second << "\n";
+  }
+  f.close();
+
+  if (!f || rename(tmp.c_str(), filename.c_str()) != 0) {
+    perror(("Manifest: " + filename).c_str());
+  }
+}
+
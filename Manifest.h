@@ -0,0 +1,60 @@
+#ifndef __plotter_Manifest__
+#define __plotter_Manifest__
+
+#include <string>
+#include <unordered_map>
+
+/**
+ * @class Manifest
+ * @brief Record of the fingerprint each output was last drawn with
+ *
+ * The manifest is a text file with one "<output> <fingerprint>" line per
+ * entry. New entries are appended with a single write, so several worker
+ * processes can record to the same manifest; later entries win. `compact`
+ * rewrites the file with only the latest entry for each output.
+ */
+class Manifest {
+public:
+  /**
+   * Constructor, loads any existing entries.
+   *
+   * @param _filename Path to the manifest file
+   */
+  Manifest(const std::string& _filename);
+
+  /**
+   * Check whether an output is up to date.
+   *
+   * @param output Output name
+   * @param fingerprint Current fingerprint of the output's inputs
+   * @returns True if the output was last drawn with this fingerprint
+   */
+  bool isCurrent(const std::string& output, const std::string& fingerprint) const;
+
+  /**
+   * Record that an output was drawn.
+   *
+   * @param output Output name
+   * @param fingerprint Fingerprint of the output's inputs
+   */
+  void record(const std::string& output, const std::string& fingerprint);
+
+  /** Rewrite the file with the latest entry for each output. */
+  void compact();
+
+  /** Version of the plotter output, part of every fingerprint. Bump this
+   *  when a change to the code changes what gets drawn. */
+  static const char* version;
+
+public:
+  std::string filename;  //!< Path to the manifest file
+
+private:
+  /** Read entries from the file. */
+  void load();
+
+  std::unordered_map<std::string, std::string> entries;  //!< Loaded entries
+};
+
+#endif  // __plotter_Manifest__
+
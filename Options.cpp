@@ -1,17 +1,101 @@
 #include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
 #include <unistd.h>
 #include <string>
 #include "Options.h"
 
 Options::Options(int argc, char* argv[]) : Options() {
+  static struct option long_options[] = {
+    { "check", no_argument, nullptr, 'n' },
+    { "force", no_argument, nullptr, 'F' },
+    { "formats", required_argument, nullptr, 'o' },
+    { "book", required_argument, nullptr, 'B' },
+    { "renderer", required_argument, nullptr, 'r' },
+    { "gallery", required_argument, nullptr, 'g' },
+    { nullptr, 0, nullptr, 0 }
+  };
+
   int c;
-  while ((c = getopt(argc, argv, "abc:")) != -1) {
+  while ((c = getopt_long(argc, argv, "abc:j:f:s:S:m:nFo:B:r:g:", long_options, nullptr)) != -1) {
     switch (c) {
       case 'c':
         config = optarg;
         break;
+      case 'j':
+        if (atoi(optarg) < 1) {
+          fprintf (stderr, "Option -j requires a positive integer.\n");
+          valid = false;
+        }
+        else {
+          njobs = atoi(optarg);
+        }
+        break;
+      case 'f':
+        if (atoi(optarg) < 0) {
+          fprintf (stderr, "Option -f requires a non-negative integer.\n");
+          valid = false;
+        }
+        else {
+          max_files = atoi(optarg);
+        }
+        break;
+      case 's':
+        stage_dir = optarg;
+        break;
+      case 'S':
+        if (atoi(optarg) < 1) {
+          fprintf (stderr, "Option -S requires a positive integer.\n");
+          valid = false;
+        }
+        else {
+          stage_size = atoi(optarg);
+        }
+        break;
+      case 'm':
+        if (atoi(optarg) < 0) {
+          fprintf (stderr, "Option -m requires a non-negative integer.\n");
+          valid = false;
+        }
+        else {
+          cache_size = atoi(optarg);
+        }
+        break;
+      case 'n':
+        check = true;
+        break;
+      case 'F':
+        force = true;
+        break;
+      case 'o': {
+        // Comma-separated list of formats
+        std::string s = optarg;
+        size_t start = 0;
+        while (start <= s.size()) {
+          size_t end = s.find(',', start);
+          if (end == std::string::npos) end = s.size();
+          if (end > start) formats.push_back(s.substr(start, end - start));
+          start = end + 1;
+        }
+        break;
+      }
+      case 'B':
+        book = optarg;
+        break;
+      case 'g':
+        gallery = optarg;
+        break;
+      case 'r':
+        renderer = optarg;
+        if (renderer != "root" && renderer != "native") {
+          fprintf (stderr, "Option -r requires root or native.\n");
+          valid = false;
+        }
+        break;
       case '?':
-        if (optopt == 'c')
+        if (optopt == 'c' || optopt == 'j' || optopt == 'f' ||
+            optopt == 's' || optopt == 'S' || optopt == 'm' || optopt == 'o' ||
+            optopt == 'B' || optopt == 'r' || optopt == 'g')
           fprintf (stderr, "Option -%c requires an argument.\n", optopt);
         else if(isprint(optopt))
           fprintf (stderr, "Unknown option `-%c'.\n", optopt);
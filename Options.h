@@ -2,6 +2,7 @@
 #define __plotter_Options__
 
 #include <string>
+#include <vector>
 
 /**
  * @struct Options
@@ -9,7 +10,8 @@
  */
 struct Options {
   /** Default ctor. */
-  Options() : valid(true), config(""), nopt(0) {}
+  Options() : valid(true), config(""), njobs(1), max_files(0), stage_dir(""), stage_size(10240),
+              cache_size(2048), check(false), force(false), formats(), book(""), renderer("root"), gallery(""), nopt(0) {}
 
   /**
    * Constructor with CLI arguments
@@ -21,6 +23,17 @@ struct Options {
 
   bool valid;  //!< Is this configuration valid?
   std::string config; //!< Configuration JSON file
+  unsigned njobs;  //!< Number of worker processes for drawing
+  unsigned max_files;  //!< Maximum open generator files, 0 for no limit
+  std::string stage_dir;  //!< Local staging directory, empty to disable
+  unsigned stage_size;  //!< Staging directory size limit (MB)
+  unsigned cache_size;  //!< Histogram cache size limit (MB), 0 for no limit
+  bool check;  //!< Only validate the configuration, don't draw
+  bool force;  //!< Redraw all plots, even if they are up to date
+  std::vector<std::string> formats;  //!< Output formats, empty for config default
+  std::string book;  //!< Multi-page PDF book filename, empty to disable
+  std::string renderer;  //!< Drawing backend for 1D plots (root, native)
+  std::string gallery;  //!< Thumbnail gallery directory, empty to disable
   unsigned nopt;  //!< Number of options specified
 };
 
@@ -1,31 +1,55 @@
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <string>
+#include <vector>
 #include "json.hh"
+#include "TCanvas.h"
+#include "TVirtualPad.h"
+#include "CanvasPool.h"
+#include "Gallery.h"
 #include "Plot.h"
 #include "Generator.h"
 
+std::vector<std::string> Plot::formats = { "pdf", "C" };
+std::string Plot::book = "";
+std::string Plot::gallery = "";
+Plot::Renderer Plot::renderer = Plot::kRenderROOT;
+CanvasPool* Plot::canvases = nullptr;
+Chi2Engine* Plot::chi2_engine = nullptr;
+
 Plot::Plot(json::Value& c) : Plot() {
   // Load settings
-  if (c.isMember("sample")) {
-    sample = c.getMember("sample").getString();
+  if (const json::Value* v = c.findMember("sample")) {
+    sample = v->getString();
   }
 
   scale_factor = 1.0;
-  if (c.isMember("scale")) {
-    scale_factor = c.getMember("scale").getReal();
+  if (const json::Value* v = c.findMember("scale")) {
+    scale_factor = v->getReal();
+  }
+
+  // chi2 from the nuiscomp summary ("file"), or recomputed ("range")
+  if (const json::Value* v = c.findMember("chi2")) {
+    const std::string& mode = v->getString();
+    assert(mode == "file" || mode == "range");
+    chi2_range = (mode == "range");
   }
 
   type = getType(c);
 
   fontsize = type == k1D ? 20 : 45;
-  if (c.isMember("fontsize")) {
-    fontsize = c.getMember("fontsize").getReal();
+  if (const json::Value* v = c.findMember("fontsize")) {
+    fontsize = v->getReal();
   }
 }
 
 
 Plot::PlotType Plot::getType(json::Value& c) {
-  if (!c.isMember("type")) return k1D;
-  std::string t = c.getMember("type").getString();
+  const json::Value* v = c.findMember("type");
+  if (!v) return k1D;
+  const std::string& t = v->getString();
   if (t == "1D") return k1D;
   else if (t == "2DSlice") return k2DSlice;
   else if (t == "2DProjection") return k2DProjection;
@@ -33,3 +57,117 @@ Plot::PlotType Plot::getType(json::Value& c) {
   return kUnknown;
 }
 
+
+bool Plot::isFormat(const std::string& format) {
+  return (format == "pdf" || format == "png" || format == "svg" ||
+          format == "C" || format == "root" || format == "data");
+}
+
+
+bool Plot::isNativeFormat(const std::string& format) {
+  return (format == "pdf" || format == "svg" || format == "data");
+}
+
+
+std::string Plot::outputPath(const std::string& filename, const std::string& format) {
+  return filename + (format == "data" ? ".data.json" : "." + format);
+}
+
+
+void Plot::openBook(const std::string& filename) {
+  book = filename;
+  TCanvas c("book_open", "", 500, 500);
+  c.Print((book + "[").c_str());
+}
+
+
+void Plot::closeBook() {
+  if (book.empty()) return;
+  TCanvas c("book_close", "", 500, 500);
+  c.Print((book + "]").c_str());
+  book = "";
+}
+
+
+TCanvas* Plot::getCanvas(int width, int height, int ncols, int nrows) {
+  if (canvases) {
+    return canvases->get(width, height, ncols, nrows);
+  }
+  return CanvasPool::create(width, height, ncols, nrows);
+}
+
+
+void Plot::releaseCanvas(TCanvas* c) {
+  if (canvases) {
+    canvases->release(c);
+  }
+  else {
+    delete c;
+  }
+}
+
+
+void Plot::save(TVirtualPad* pad, const std::string& filename, bool skip_native) {
+  if (filename.empty()) return;
+
+  for (const std::string& format : formats) {
+    if (skip_native && isNativeFormat(format)) {
+      continue;
+    }
+    else if (format == "data") {
+      writeData(filename);
+    }
+    else {
+      pad->SaveAs(outputPath(filename, format).c_str());
+    }
+  }
+
+  if (!book.empty()) {
+    pad->Print(book.c_str(), ("Title:" + filename).c_str());
+  }
+
+  if (!gallery.empty()) {
+    Gallery::thumbnail(pad, Gallery::thumbnailPath(gallery, filename));
+    Gallery::writeChi2(Gallery::chi2Path(gallery, filename), legendChi2());
+  }
+}
+
+
+bool Plot::writeData(const std::string& filename) const {
+  std::vector<double> columns;
+  json::Value panels = exportPanels(columns);
+
+  // Columns first, so that a complete index implies complete data
+  std::string bin_path = filename + ".data.bin";
+  FILE* f = fopen(bin_path.c_str(), "wb");
+  if (!f) {
+    perror(("Plot: " + bin_path).c_str());
+    return false;
+  }
+  bool ok = fwrite(columns.data(), sizeof(double), columns.size(), f) == columns.size();
+  ok = (fclose(f) == 0) && ok;
+  if (!ok) return false;
+
+  const char* types[] = { "1D", "2DSlice", "2DProjection", "3D", "unknown" };
+  const uint16_t one = 1;
+  bool little = *((const char*) &one) == 1;
+  size_t slash = bin_path.rfind('/');
+
+  json::Value index(json::TOBJECT);
+  index.setMember("version", json::Value(1));
+  index.setMember("sample", json::Value(sample));
+  index.setMember("type", json::Value(std::string(types[type])));
+  index.setMember("binary", json::Value(slash == std::string::npos ? bin_path
+                                                                   : bin_path.substr(slash + 1)));
+  index.setMember("dtype", json::Value(std::string("float64")));
+  index.setMember("byte_order", json::Value(std::string(little ? "little" : "big")));
+  index.setMember("scale_factor", json::Value(scale_factor));
+  index.setMember("panels", panels);
+
+  std::ofstream out(filename + ".data.json");
+  json::Writer writer(out);
+  writer.putValue(index);
+  out << std::endl;
+  return out.good();
+}
+
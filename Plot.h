@@ -2,9 +2,14 @@
 #define __plotter_Plot__
 
 #include <string>
+#include <utility>
+#include <vector>
 #include "json.hh"
 
+class CanvasPool;
+class Chi2Engine;
 class Generator;
+class TCanvas;
 class TVirtualPad;
 
 /**
@@ -19,7 +24,7 @@ public:
   };
 
   /** Default ctor. */
-  Plot() : type(kUnknown) {}
+  Plot() : type(kUnknown), chi2_range(false) {}
 
   /**
    * Constructor with a JSON configuration.
@@ -38,6 +43,24 @@ public:
    */
   virtual void add(Generator* gen) = 0;
 
+  /**
+   * List the objects that `add` will read from a generator.
+   *
+   * @param gen The Generator
+   * @param data_source True if the plot's data are read from this generator
+   * @returns Names of the objects
+   */
+  virtual std::vector<std::string> getKeys(Generator* gen, bool data_source) const = 0;
+
+  /**
+   * Check that the plot can be built from a set of generators, without
+   * drawing anything.
+   *
+   * @param gens The generators that will be added
+   * @returns A description of each problem found
+   */
+  virtual std::vector<std::string> check(const std::vector<Generator*>& gens) const = 0;
+
   /**
    * Draw the plot.
    *
@@ -45,14 +68,128 @@ public:
    */
   virtual void draw(std::string filename="", TVirtualPad* pad=nullptr) = 0;
 
+  /**
+   * Release everything built by `add` and `draw`, keeping the configuration.
+   *
+   * Call this once the plot has been saved; the plot can then be rebuilt
+   * with `add`.
+   */
+  virtual void clear() = 0;
+
+  /**
+   * Describe the plotted data for export.
+   *
+   * @param columns Column store; each panel's arrays are appended to it
+   * @returns JSON array with one object per panel, referring to columns by
+   *          offset and length
+   */
+  virtual json::Value exportPanels(std::vector<double>& columns) const = 0;
+
+  /**
+   * The chi2/ndof shown in the legend for each generator, for the gallery.
+   *
+   * @returns (Generator, chi2/ndof) pairs; empty if the legends do not show
+   *          one value per generator, as with a chi2 recomputed per slice
+   */
+  virtual std::vector<std::pair<std::string, std::string> > legendChi2() const = 0;
+
+  /** Drawing backends. */
+  enum Renderer {
+    kRenderROOT, kRenderNative
+  };
+
   /** Extract the type of plot. */
   static PlotType getType(json::Value& c);
 
+  /**
+   * Check whether an output format is supported.
+   *
+   * @param format File extension (pdf, png, svg, C, root), or data for the
+   *               data export
+   */
+  static bool isFormat(const std::string& format);
+
+  /**
+   * Check whether the native renderer writes an output format (PDF, SVG and
+   * the data export).
+   *
+   * @param format Output format
+   */
+  static bool isNativeFormat(const std::string& format);
+
+  /**
+   * Path of the file written for an output format. The data export is
+   * checked by its index file, which is written last.
+   *
+   * @param filename Output filename, without extension
+   * @param format Output format
+   */
+  static std::string outputPath(const std::string& filename, const std::string& format);
+
+  /**
+   * Start a multi-page PDF book. Every plot saved until closeBook is called
+   * is appended to it as a page.
+   *
+   * @param filename Book PDF filename
+   */
+  static void openBook(const std::string& filename);
+
+  /** Finish the multi-page PDF book. */
+  static void closeBook();
+
+protected:
+  /**
+   * Get a canvas to draw on, from the canvas pool if there is one.
+   *
+   * @param width Width in pixels
+   * @param height Height in pixels
+   * @param ncols Pad columns, 0 for an undivided canvas
+   * @param nrows Pad rows, 0 for an undivided canvas
+   */
+  static TCanvas* getCanvas(int width, int height, int ncols=0, int nrows=0);
+
+  /**
+   * Finish with a canvas from getCanvas: return it to the pool, or delete it.
+   *
+   * @param c The canvas
+   */
+  static void releaseCanvas(TCanvas* c);
+
+  /**
+   * Save a drawn plot in all output formats, to the book if open, and as a
+   * gallery thumbnail if enabled.
+   *
+   * @param pad The pad to save
+   * @param filename Output filename, without extension; nothing is saved if
+   *                 it is empty
+   * @param skip_native Skip the formats already written by the native
+   *                    renderer
+   */
+  void save(TVirtualPad* pad, const std::string& filename, bool skip_native=false);
+
+  /**
+   * Export the plotted data: a binary file of float64 columns in native
+   * byte order (filename.data.bin), and a JSON index describing them
+   * (filename.data.json).
+   *
+   * @param filename Output filename, without extension
+   * @returns True on success
+   */
+  bool writeData(const std::string& filename) const;
+
 public:
   std::string sample;  //!< NUISANCE sample name
   PlotType type;  //!< Type of plot
   double fontsize;  //!< Label and title size
   double scale_factor;  //!< Scale factor
+  bool chi2_range;  //!< Recompute the chi2 over the displayed bins
+
+  static std::vector<std::string> formats;  //!< Output formats (extensions)
+  static std::string book;  //!< Book PDF filename, empty if none
+  static std::string gallery;  //!< Thumbnail gallery directory, empty if none
+  static Renderer renderer;  //!< Backend for standalone 1D plots
+  static CanvasPool* canvases;  //!< Canvases to reuse, null to make new ones
+  static Chi2Engine* chi2_engine;  //!< Chi2 computation, null to only use the file's values
 };
 
 #endif  // __plotter_Plot__
@@ -1,25 +1,107 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <string>
+#include <vector>
 #include "json.hh"
 #include "TCanvas.h"
+#include "TColor.h"
 #include "TH1D.h"
 #include "TLatex.h"
 #include "TLegend.h"
+#include "TROOT.h"
 #include "TVirtualPad.h"
 #include "Plot.h"
 #include "Plot1D.h"
+#include "Chi2Engine.h"
 #include "Generator.h"
+#include "HistView.h"
+#include "VectorCanvas.h"
 #include "TPaveText.h"
 
+namespace {
+
+/** RGB components of a ROOT color index. */
+VectorCanvas::Color rootColor(int index) {
+  TColor* c = gROOT->GetColor(index);
+  if (!c) return VectorCanvas::Color();
+  return VectorCanvas::Color(c->GetRed(), c->GetGreen(), c->GetBlue());
+}
+
+
+/**
+ * Choose axis ticks like ROOT's default 505 divisions: about five major
+ * ticks at a round step, each divided in five.
+ *
+ * @param lo Axis minimum
+ * @param hi Axis maximum
+ * @param major Major tick positions
+ * @param minor Minor tick positions
+ * @returns The major tick step
+ */
+double axisTicks(double lo, double hi, std::vector<double>& major,
+                 std::vector<double>& minor) {
+  double raw = (hi - lo) / 5;
+  if (raw <= 0) return 1;
+
+  double mag = std::pow(10, std::floor(std::log10(raw)));
+  double f = raw / mag;
+  double step = (f <= 1 ? 1 : f <= 2 ? 2 : f <= 5 ? 5 : 10) * mag;
+
+  double eps = step * 1e-6;
+  for (double v=std::ceil((lo - eps) / (step / 5)) * step / 5; v<=hi+eps; v+=step/5) {
+    double r = std::round(v / step) * step;
+    if (std::fabs(v - r) < eps) {
+      major.push_back(r);
+    }
+    else {
+      minor.push_back(v);
+    }
+  }
+
+  return step;
+}
+
+
+/**
+ * Label for a tick at value v, with enough digits for the step and no
+ * trailing zeros, as ROOT writes them.
+ */
+std::string tickLabel(double v, double step) {
+  int digits = std::max(0, int(-std::floor(std::log10(step) + 1e-9)));
+  if (std::fabs(v) < step * 1e-6) v = 0;
+  std::string s = Form("%.*f", digits, v);
+  if (s.find('.') != std::string::npos) {
+    s.erase(s.find_last_not_of('0') + 1);
+    if (s.back() == '.') s.pop_back();
+  }
+  return s;
+}
+
+}  // namespace
+
 void Plot1D::AxisRangeX::operator()(TH1D* h) {
   h->GetXaxis()->SetRangeUser(xmin, xmax);
 }
 
 
-Plot1D::LegendPos::LegendPos(json::Value& vpos) {
+void Plot1D::AxisRangeX::getBins(const TH1D* h, int& first, int& last) const {
+  const TAxis* axis = h->GetXaxis();
+  first = std::max(axis->FindFixBin(xmin), 1);
+  last = std::min(axis->FindFixBin(xmax), axis->GetNbins());
+  if (last > first && axis->GetBinLowEdge(last) >= xmax) {
+    last--;
+  }
+
+  // An empty selection is first - 1, never less
+  last = std::max(last, first - 1);
+}
+
+
+Plot1D::LegendPos::LegendPos(const json::Value& vpos) {
   if (vpos.getType() == json::TSTRING) {
     // Use a pre-defined position
-    std::string spos = vpos.getString();
+    const std::string& spos = vpos.getString();
     if      (spos == "UL") set( true, 0.19, 0.65, 0.70, 0.85);
     else if (spos == "UC") set( true, 0.25, 0.65, 0.75, 0.85);
     else if (spos == "LL") set( true, 0.19, 0.18, 0.70, 0.41);
@@ -30,8 +112,10 @@ Plot1D::LegendPos::LegendPos(json::Value& vpos) {
   }
   else if (vpos.getType() == json::TARRAY) {
     // User-specified position
-    std::vector<double> lcoord = vpos.toVector<double>();
-    set(true, lcoord[0], lcoord[1], lcoord[2], lcoord[3]);
+    const json::TArray& lcoord = vpos.getArray();
+    assert(lcoord.size() == 4);
+    set(true, lcoord[0].cast<double>(), lcoord[1].cast<double>(),
+              lcoord[2].cast<double>(), lcoord[3].cast<double>());
   }
 }
 
@@ -46,94 +130,301 @@ void Plot1D::LegendPos::set(bool _draw, float _x1, float _y1, float _x2, float _
 
 
 Plot1D::Plot1D(json::Value& c)
-    : Plot(c), hdata(nullptr), xranger(nullptr), ymax(-1) {
+    : Plot(c), hdata(nullptr), data_gen(nullptr), applied_scale(1), cov_offset(0),
+      cov_stride(1), ymax(-1), ymax_config(-1), xranger(nullptr) {
   // Load settings
-  if (c.isMember("xrange")) {
-    std::vector<double> range = c.getMember("xrange").toVector<double>();
+  if (const json::Value* v = c.findMember("xrange")) {
+    const json::TArray& range = v->getArray();
     assert(range.size() == 2);
-    xranger = new AxisRangeX(range[0], range[1]);
+    assert(range[0].cast<double>() < range[1].cast<double>());
+    xranger = new AxisRangeX(range[0].cast<double>(), range[1].cast<double>());
   }
 
-  if (c.isMember("ymax")) {
-    ymax = c.getMember("ymax").getReal();
+  if (const json::Value* v = c.findMember("ymax")) {
+    ymax_config = v->getReal();
   }
+  ymax = ymax_config;
 
-  if (c.isMember("xtitle")) {
-    xtitle = c.getMember("xtitle").getString();
+  if (const json::Value* v = c.findMember("xtitle")) {
+    xtitle = v->getString();
   }
 
-  if (c.isMember("ytitle")) {
-    ytitle = c.getMember("ytitle").getString();
+  if (const json::Value* v = c.findMember("ytitle")) {
+    ytitle = v->getString();
   }
 
-  if (c.isMember("annotate")) {
-    annotate = c.getMember("annotate").getString();
+  if (const json::Value* v = c.findMember("annotate")) {
+    annotate = v->getString();
   }
 
-  if (c.isMember("data_label")) {
-    data_label = c.getMember("data_label").getString();
+  if (const json::Value* v = c.findMember("data_label")) {
+    data_label = v->getString();
   }
   else {
     data_label = "Data";
   }
 
-  ytitle_offset = c.isMember("ytitle_offset") ? c.getMember("ytitle_offset").getReal() : 1.25;
+  const json::Value* voffset = c.findMember("ytitle_offset");
+  ytitle_offset = voffset ? voffset->getReal() : 1.25;
 
-  if (c.isMember("legend_pos")) {
-    json::Value& vpos = c.getMember("legend_pos");
-    lloc = LegendPos(vpos);
+  if (const json::Value* vpos = c.findMember("legend_pos")) {
+    lloc = LegendPos(*vpos);
   }
 }
 
 
+Plot1D::~Plot1D() {
+  clear();
+  delete xranger;
+}
+
+
+void Plot1D::clear() {
+  delete hdata;
+  hdata = nullptr;
+  data_gen = nullptr;
+
+  for (TH1D* line : lines) {
+    delete line;
+  }
+  lines.clear();
+  sources.clear();
+  applied_scale = 1;
+  ymax = ymax_config;
+}
+
+
 void Plot1D::add(Generator* gen) {
+  const SampleCatalog::Entry* entry = gen->catalog.find(sample);
+  assert(entry);
+
   // Extract the MC histogram for this generator
-  std::string mc = sample + "_MC";
-  TH1D* hmc = dynamic_cast<TH1D*>(gen->getHistogram(mc));
+  TH1D* hmc = dynamic_cast<TH1D*>(gen->getHistogram(entry->mc));
   assert(hmc);
 
+  // Set the data once (should be the same in all files)
+  if (!hdata) {
+    hdata = dynamic_cast<TH1D*>(gen->getHistogram(entry->data));
+    assert(hdata);
+    hdata->SetLineColor(kBlack);
+    data_gen = gen;
+  }
+
   // Build a legend title: name and chi2/ndf
   std::string title = gen->title + " (#chi^{2}=" + gen->getChi2String(sample) + ")";
   hmc->SetTitle(title.c_str());
-  lines.push_back(hmc);
+  addLine(hmc, gen, sample);
+}
 
-  // Set the data once (should be the same in all files)
-  if (!hdata) {
-    std::string data = sample + "_data";
-    hdata = dynamic_cast<TH1D*>(gen->getHistogram(data));
-    if (!hdata) {
-      data = sample + "_DATA";
-      hdata = dynamic_cast<TH1D*>(gen->getHistogram(data));
+
+std::vector<std::string> Plot1D::getKeys(Generator* gen, bool data_source) const {
+  std::vector<std::string> keys;
+  const SampleCatalog::Entry* entry = gen->catalog.find(sample);
+  if (entry) {
+    if (!entry->mc.empty()) keys.push_back(entry->mc);
+    if (data_source && !entry->data.empty()) keys.push_back(entry->data);
+    if (data_source && chi2_range && !entry->covariance.empty()) {
+      keys.push_back(entry->covariance);
     }
-    if (!hdata) {
-      data = sample;
-      hdata = dynamic_cast<TH1D*>(gen->getHistogram(data));
+  }
+  return keys;
+}
+
+
+std::vector<std::string> Plot1D::check(const std::vector<Generator*>& gens) const {
+  std::vector<std::string> problems;
+  for (size_t i=0; i<gens.size(); i++) {
+    const SampleCatalog::Entry* entry = gens[i]->catalog.find(sample);
+    if (!entry || entry->mc.empty()) {
+      problems.push_back(gens[i]->title + ": No MC histogram");
     }
-    assert(hdata);
-    hdata->SetLineColor(kBlack);
+
+    // The data are taken from the first generator
+    if (i == 0 && (!entry || entry->data.empty())) {
+      problems.push_back(gens[i]->title + ": No data histogram");
+    }
+  }
+  return problems;
+}
+
+
+void Plot1D::addLine(TH1D* line, Generator* gen, const std::string& chi2_sample) {
+  Generator::Chi2 c = gen->getChi2(chi2_sample);
+
+  // Recompute over the displayed bins, with the sample covariance if the
+  // data file has one. It is only read if the engine has no factor for it.
+  if (chi2_range && chi2_engine) {
+    assert(hdata && data_gen);
+    const SampleCatalog::Entry* entry = data_gen->catalog.find(chi2_sample);
+    Chi2Engine::Loader load_cov;
+    if (entry && !entry->covariance.empty()) {
+      Generator* source = data_gen;
+      std::string key = entry->covariance;
+      load_cov = [source, key]() { return source->getShared(key); };
+    }
+
+    int first, last;
+    getBins(first, last);
+    c = chi2_engine->compute(chi2_sample, load_cov,
+                             makeView(hdata).range(first - 1, last),
+                             makeView(line).range(first - 1, last),
+                             cov_offset + (first - 1) * cov_stride, cov_stride);
+
+    std::string title = gen->title + " (#chi^{2}=" + Generator::formatChi2(c) + ")";
+    line->SetTitle(title.c_str());
   }
+
+  lines.push_back(line);
+  sources.push_back({ gen->title, c.chi2, c.ndof });
 }
 
 
 void Plot1D::scale(float factor) {
-  hdata->Scale(factor);
+  scaleHist(hdata, factor);
+
+  for (TH1D* line : lines) {
+    scaleHist(line, factor);
+  }
+
+  applied_scale *= factor;
+}
+
+
+void Plot1D::getBins(int& first, int& last) const {
+  first = 1;
+  last = hdata->GetNbinsX();
+  if (xranger) {
+    xranger->getBins(hdata, first, last);
+  }
+}
+
+
+json::Value Plot1D::exportPanels(std::vector<double>& columns) const {
+  return json::Value(std::vector<json::Value>(1, exportPanel(columns)));
+}
+
+
+std::vector<std::pair<std::string, std::string> > Plot1D::legendChi2() const {
+  std::vector<std::pair<std::string, std::string> > chi2;
+  for (const LineSource& source : sources) {
+    Generator::Chi2 c;
+    c.chi2 = source.chi2;
+    c.ndof = source.ndof;
+    chi2.emplace_back(source.generator, Generator::formatChi2(c));
+  }
+  return chi2;
+}
+
+
+json::Value Plot1D::exportPanel(std::vector<double>& columns) const {
+  // Append a column and return its location
+  auto column = [&](const std::vector<double>& v) {
+    json::Value ref(json::TOBJECT);
+    ref.setMember("offset", json::Value(columns.size()));
+    ref.setMember("length", json::Value(v.size()));
+    columns.insert(columns.end(), v.begin(), v.end());
+    return ref;
+  };
+
+  int first, last;
+  getBins(first, last);
+  HistView<double> vdata = makeView(hdata).range(first - 1, last);
+
+  // An xrange that selects no bins gives an empty panel, with no edges
+  std::vector<double> edges, content(vdata.size()), error(vdata.size());
+  for (size_t i=0; i<vdata.size(); i++) {
+    edges.push_back(vdata.lowEdge(i));
+    content[i] = vdata.content(i);
+    error[i] = vdata.error(i);
+  }
+  if (vdata.size() > 0) {
+    edges.push_back(vdata.upEdge(vdata.size() - 1));
+  }
+
+  json::Value data(json::TOBJECT);
+  data.setMember("label", json::Value(data_label));
+  data.setMember("content", column(content));
+  data.setMember("error", column(error));
+
+  std::vector<json::Value> mc;
+  for (size_t j=0; j<lines.size(); j++) {
+    HistView<double> v = makeView(lines[j]).range(first - 1, last);
+    for (size_t i=0; i<v.size(); i++) {
+      content[i] = v.content(i);
+    }
+
+    json::Value line(json::TOBJECT);
+    line.setMember("title", json::Value(std::string(lines[j]->GetTitle())));
+    if (j < sources.size()) {
+      line.setMember("generator", json::Value(sources[j].generator));
+      line.setMember("chi2", json::Value(sources[j].chi2));
+      line.setMember("ndof", json::Value(sources[j].ndof));
+    }
+    line.setMember("content", column(content));
+    mc.push_back(line);
+  }
+
+  json::Value panel(json::TOBJECT);
+  panel.setMember("xtitle", json::Value(xtitle.empty() ? std::string(hdata->GetXaxis()->GetTitle())
+                                                       : xtitle));
+  panel.setMember("ytitle", json::Value(ytitle.empty() ? std::string(hdata->GetYaxis()->GetTitle())
+                                                       : ytitle));
+  panel.setMember("annotate", json::Value(annotate));
+  panel.setMember("ymax", json::Value(ymax));
+  panel.setMember("scale", json::Value(applied_scale));
+  panel.setMember("edges", column(edges));
+  panel.setMember("data", data);
+  panel.setMember("mc", json::Value(mc));
+
+  if (slice.size() == 2) {
+    json::Value s(json::TOBJECT);
+    s.setMember("title", json::Value(slice_title));
+    s.setMember("min", json::Value(slice[0]));
+    s.setMember("max", json::Value(slice[1]));
+    panel.setMember("slice", s);
+  }
+
+  return panel;
+}
+
+
+double Plot1D::autoYmax(int first, int last) const {
+  BinStats s = makeView(hdata).range(first - 1, last).stats();
+  double y = (s.max + std::sqrt(s.max_error2)) * 1.05;
 
   for (TH1D* line : lines) {
-    line->Scale(factor);
+    double line_max = makeView(line).stats().max;
+    if (line_max > y) {
+      y = line_max * 1.1;
+    }
   }
+
+  return y;
 }
 
 
 void Plot1D::draw(std::string filename, TVirtualPad* pad) {
+  // Standalone plots are written by the native renderer where it can. ROOT
+  // graphics are still needed for the other formats, the book and gallery
+  // thumbnails.
+  bool native = (!pad && renderer == kRenderNative);
+  if (native) {
+    drawNative(filename);
+
+    bool rest = !book.empty() || !gallery.empty();
+    for (const std::string& format : formats) {
+      if (!isNativeFormat(format)) rest = true;
+    }
+    if (!rest) return;
+  }
+
   // Canvas setup
-  bool own_pad = false;
+  TCanvas* canvas = nullptr;
   if (!pad) {
-    pad = new TCanvas("c", "", 500, 500);
-    assert(pad);
+    pad = canvas = getCanvas(500, 500);
     pad->SetLeftMargin(0.18);
     pad->SetTopMargin(0.12);
     pad->SetBottomMargin(0.15);
-    own_pad = true;
   }
 
   pad->cd();
@@ -170,13 +461,17 @@ void Plot1D::draw(std::string filename, TVirtualPad* pad) {
     (*xranger)(hdata);
   }
 
-  // Automatically set the y axis range to avoid clipping any plot
-  bool ymax_auto = ymax < 0;
-  if (ymax_auto) {
-    ymax = (hdata->GetMaximum() + hdata->GetBinError(hdata->GetMaximumBin())) * 1.05;
+  // Automatically set the y axis range to avoid clipping any plot, only
+  // considering the data in the displayed x range
+  if (ymax < 0) {
+    const TAxis* xaxis = hdata->GetXaxis();
+    int first = std::max(xaxis->GetFirst(), 1);
+    int last = std::min(xaxis->GetLast(), hdata->GetNbinsX());
+    ymax = autoYmax(first, last);
   }
 
-  // Set the legend position
+  // Set the legend position. Drawn decorations are owned by the pad
+  // (kCanDelete) and deleted along with it.
   TLegend* l = new TLegend(lloc.x1, lloc.y1, lloc.x2, lloc.y2);
 
   // Draw legend for data
@@ -188,18 +483,18 @@ void Plot1D::draw(std::string filename, TVirtualPad* pad) {
     line->Draw("hist same");
     line->SetMarkerSize(0);
     l->AddEntry(line, line->GetTitle());
-
-    if (ymax_auto && line->GetMaximum() > ymax) {
-      ymax = line->GetMaximum() * 1.1;
-    }
   }
 
   // Redraw the data on top
   hdata->Draw("e1 same");
   hdata->GetYaxis()->SetRangeUser(0, ymax);
   if (lloc.draw) {
+    l->SetBit(kCanDelete);
     l->Draw();
   }
+  else {
+    delete l;
+  }
 
   // Add annotation label, if any
   TPaveText* tla = nullptr;
@@ -217,20 +512,193 @@ void Plot1D::draw(std::string filename, TVirtualPad* pad) {
       tla->AddText(s.c_str());
     }
 
+    tla->SetBit(kCanDelete);
     tla->Draw();
   }
 
   pad->Update();
 
   // Save the final canvas
-  if (filename != "") {
-    pad->SaveAs((filename + ".pdf").c_str());
-    pad->SaveAs((filename + ".C").c_str());
+  save(pad, filename, native);
+
+  // Done with the canvas, if it is ours
+  if (canvas) {
+    releaseCanvas(canvas);
+  }
+}
+
+
+void Plot1D::drawNative(const std::string& filename) {
+  // Same geometry as the ROOT canvas: 500x500 with the same margins, and
+  // font sizes in pixels (here points)
+  const double w = 500;
+  const double h = 500;
+  const double fx0 = 0.18 * w;
+  const double fx1 = 0.90 * w;
+  const double fy0 = 0.15 * h;
+  const double fy1 = 0.88 * h;
+  const VectorCanvas::Color black;
+  VectorCanvas c(w, h);
+
+  // Displayed range
+  int first, last;
+  getBins(first, last);
+
+  if (ymax < 0) {
+    ymax = autoYmax(first, last);
+  }
+
+  // An xrange that selects no bins leaves an empty frame over the whole axis
+  HistView<double> vdata = makeView(hdata).range(first - 1, last);
+  double xlo = hdata->GetXaxis()->GetXmin();
+  double xhi = hdata->GetXaxis()->GetXmax();
+  if (vdata.size() > 0) {
+    xlo = vdata.lowEdge(0);
+    xhi = vdata.upEdge(vdata.size() - 1);
+  }
+  double ytop = ymax > 0 ? ymax : 1;
+
+  auto px = [&](double x) { return fx0 + (x - xlo) / (xhi - xlo) * (fx1 - fx0); };
+  auto py = [&](double y) {
+    return fy0 + std::min(std::max(y / ytop, 0.0), 1.0) * (fy1 - fy0);
+  };
+
+  // MC lines, as steps starting and ending on the x axis
+  for (TH1D* line : lines) {
+    HistView<double> v = makeView(line).range(first - 1, last);
+    if (v.size() == 0) continue;
+    std::vector<double> xs, ys;
+    xs.push_back(px(v.lowEdge(0)));
+    ys.push_back(py(0));
+    for (size_t i=0; i<v.size(); i++) {
+      double y = py(v.content(i));
+      xs.push_back(px(v.lowEdge(i)));
+      ys.push_back(y);
+      xs.push_back(px(v.upEdge(i)));
+      ys.push_back(y);
+    }
+    xs.push_back(px(v.upEdge(v.size() - 1)));
+    ys.push_back(py(0));
+    c.polyline(xs, ys, rootColor(line->GetLineColor()), line->GetLineWidth());
+  }
+
+  // Data points with error bars and end caps ("e1"); empty bins are skipped
+  for (size_t i=0; i<vdata.size(); i++) {
+    double y = vdata.content(i);
+    double e = vdata.error(i);
+    if (y == 0 && e == 0) continue;
+
+    double x = px((vdata.lowEdge(i) + vdata.upEdge(i)) / 2);
+    c.line(px(vdata.lowEdge(i)), py(y), px(vdata.upEdge(i)), py(y), black);
+    c.line(x, py(y - e), x, py(y + e), black);
+    c.line(x - 2, py(y - e), x + 2, py(y - e), black);
+    c.line(x - 2, py(y + e), x + 2, py(y + e), black);
+    if (y >= 0 && y <= ytop) {
+      c.circle(x, py(y), 3.5, black);
+    }
+  }
+
+  // Axes: ticks inside the frame on the bottom and left
+  std::vector<double> major, minor;
+  double step = axisTicks(xlo, xhi, major, minor);
+  double tick = 0.03 * (fy1 - fy0);
+  for (double x : major) {
+    c.line(px(x), fy0, px(x), fy0 + tick, black);
+    c.text(px(x), fy0 - 1.05 * fontsize, tickLabel(x, step), fontsize,
+           VectorCanvas::kCenter);
+  }
+  for (double x : minor) {
+    c.line(px(x), fy0, px(x), fy0 + tick / 2, black);
+  }
+
+  // Large or small y values are labeled in units of a power of ten
+  int exponent = 0;
+  if (ytop < 1e-2 || ytop >= 1e5) {
+    exponent = std::floor(std::log10(ytop));
+  }
+  double yscale = std::pow(10, exponent);
+
+  major.clear();
+  minor.clear();
+  step = axisTicks(0, ytop / yscale, major, minor);
+  tick = 0.03 * (fx1 - fx0);
+  for (double y : major) {
+    c.line(fx0, py(y * yscale), fx0 + tick, py(y * yscale), black);
+    c.text(fx0 - 0.01 * w, py(y * yscale) - 0.35 * fontsize, tickLabel(y, step),
+           fontsize, VectorCanvas::kRight);
+  }
+  for (double y : minor) {
+    c.line(fx0, py(y * yscale), fx0 + tick / 2, py(y * yscale), black);
+  }
+
+  if (exponent != 0) {
+    c.text(fx0, fy1 + 0.3 * fontsize,
+           VectorCanvas::convertLatex(Form("#times10^{%d}", exponent)),
+           fontsize, VectorCanvas::kLeft);
+  }
+
+  // Axis titles, aligned to the right/top ends of the axes
+  std::string xt = xtitle.empty() ? hdata->GetXaxis()->GetTitle() : xtitle;
+  std::string yt = ytitle.empty() ? hdata->GetYaxis()->GetTitle() : ytitle;
+  c.text(fx1, fy0 - 1.3 * 1.6 * fontsize, VectorCanvas::convertLatex(xt),
+         fontsize, VectorCanvas::kRight);
+  c.text(fx0 - ytitle_offset * 2.0 * fontsize, fy1, VectorCanvas::convertLatex(yt),
+         fontsize, VectorCanvas::kRight, 90);
+
+  c.rect(fx0, fy0, fx1, fy1, black);
+
+  // Legend, one row per entry with the symbol in the left quarter
+  if (lloc.draw) {
+    double lx0 = lloc.x1 * w;
+    double ly0 = lloc.y1 * h;
+    double lx1 = lloc.x2 * w;
+    double ly1 = lloc.y2 * h;
+    c.rect(lx0, ly0, lx1, ly1, VectorCanvas::Color(1, 1, 1), 0, true);
+
+    double row = (ly1 - ly0) / (lines.size() + 1);
+    double size = std::min(0.75 * row, 0.9 * fontsize);
+    double sx = lx0 + 0.125 * (lx1 - lx0);
+    double sw = 0.08 * (lx1 - lx0);
+    double tx = lx0 + 0.27 * (lx1 - lx0);
+
+    double y = ly1 - row / 2;
+    c.line(sx, y - row / 3, sx, y + row / 3, black);
+    c.circle(sx, y, 3.5, black);
+    c.text(tx, y - 0.35 * size, VectorCanvas::convertLatex(data_label), size,
+           VectorCanvas::kLeft, 0, VectorCanvas::kHelvetica);
+
+    for (TH1D* line : lines) {
+      y -= row;
+      c.line(sx - sw, y, sx + sw, y, rootColor(line->GetLineColor()),
+             line->GetLineWidth());
+      c.text(tx, y - 0.35 * size, VectorCanvas::convertLatex(line->GetTitle()), size,
+             VectorCanvas::kLeft, 0, VectorCanvas::kHelvetica);
+    }
+  }
+
+  // Annotation lines, right and top aligned in the same box as the ROOT
+  // version
+  if (!annotate.empty()) {
+    std::vector<std::string> labels;
+    std::stringstream ss(annotate);
+    std::string s;
+    while (getline(ss, s, ';')) {
+      labels.push_back(s);
+    }
+
+    double band = (0.99 - 0.8) * h / labels.size();
+    for (size_t i=0; i<labels.size(); i++) {
+      c.text(0.88 * w, 0.99 * h - i * band - 0.85 * fontsize,
+             VectorCanvas::convertLatex(labels[i]), fontsize, VectorCanvas::kRight);
+    }
   }
 
-  // Delete the TCanvas if we own it
-  if (own_pad) {
-    delete pad;
+  // Save
+  if (filename.empty()) return;
+  for (const std::string& format : formats) {
+    if (format == "svg") c.writeSVG(outputPath(filename, format));
+    if (format == "pdf") c.writePDF(outputPath(filename, format));
+    if (format == "data") writeData(filename);
   }
 }
 
@@ -35,6 +35,15 @@ public:
      */
     void operator()(TH1D* h);
 
+    /**
+     * Find the bins shown in the range, as TAxis::SetRangeUser would.
+     *
+     * @param h Histogram
+     * @param first First bin shown (from 1)
+     * @param last Last bin shown
+     */
+    void getBins(const TH1D* h, int& first, int& last) const;
+
   private:
     float xmax;  //!< Range maximum
     float xmin;  //!< Range minimum
@@ -66,7 +75,7 @@ public:
      *
      * @param vpos Position configuration object
      */
-    LegendPos(json::Value& vpos);
+    LegendPos(const json::Value& vpos);
 
     /**
      * Set all parameters.
@@ -86,8 +95,23 @@ public:
     float y2;  //!< Upper y
   };
 
+  /**
+   * @struct LineSource
+   * @brief Where an MC line came from, for export
+   */
+  struct LineSource {
+    std::string generator;  //!< Generator title
+    double chi2;  //!< Sample chi2, -1 if not available
+    double ndof;  //!< Sample ndof, -1 if not available
+  };
+
   /** Default ctor. */
-  Plot1D() : Plot(), hdata(nullptr), xranger(nullptr) {}
+  Plot1D()
+      : Plot(), hdata(nullptr), data_gen(nullptr), applied_scale(1), cov_offset(0),
+        cov_stride(1), xranger(nullptr) {}
+
+  /** Destructor. */
+  ~Plot1D();
 
   /**
    * Constructor.
@@ -103,6 +127,38 @@ public:
    */
   void add(Generator* gen);
 
+  /**
+   * List the objects that `add` will read from a generator.
+   *
+   * @param gen The Generator
+   * @param data_source True if the plot's data are read from this generator
+   * @returns Names of the objects
+   */
+  std::vector<std::string> getKeys(Generator* gen, bool data_source) const;
+
+  /**
+   * Check that the plot can be built from a set of generators, without
+   * drawing anything.
+   *
+   * @param gens The generators that will be added
+   * @returns A description of each problem found
+   */
+  std::vector<std::string> check(const std::vector<Generator*>& gens) const;
+
+  /**
+   * Add an MC line, recording the generator it came from.
+   *
+   * If the chi2 is recomputed (chi2_range), it covers the displayed bins,
+   * the line title is updated to match, and the data must already be set.
+   * The covariance is taken from the data generator, so every line uses
+   * the same one.
+   *
+   * @param line The MC histogram, now owned by the plot
+   * @param gen The Generator
+   * @param chi2_sample Sample to take the chi2/ndof from
+   */
+  void addLine(TH1D* line, Generator* gen, const std::string& chi2_sample);
+
   /**
    * Scale by a constant.
    *
@@ -117,11 +173,37 @@ public:
    */
   void draw(std::string filename="", TVirtualPad* pad=nullptr);
 
+  /** Delete the data and MC histograms. */
+  void clear();
+
+  /** Describe the plotted data for export, as a single panel. */
+  json::Value exportPanels(std::vector<double>& columns) const;
+
+  /** The chi2/ndof in the legend for each generator. */
+  std::vector<std::pair<std::string, std::string> > legendChi2() const;
+
+  /**
+   * Describe the plotted data for export: bin edges, data and errors, and
+   * MC lines in the displayed range, plus the chi2/ndof, scaling and slice.
+   *
+   * @param columns Column store to append the arrays to
+   * @returns JSON object describing the panel
+   */
+  json::Value exportPanel(std::vector<double>& columns) const;
+
 public:
-  TH1D* hdata;  //!< Data histogram
-  std::vector<TH1D*> lines;  //!< MC histograms
+  TH1D* hdata;  //!< Data histogram (owned)
+  Generator* data_gen;  //!< Generator the data and covariance are read from
+  std::vector<TH1D*> lines;  //!< MC histograms (owned)
+  std::vector<LineSource> sources;  //!< Source of each MC line
+  double applied_scale;  //!< Product of all scale factors applied
+  std::vector<double> slice;  //!< 2D slice bounds (min, max), empty if none
+  std::string slice_title;  //!< Title of the sliced axis
+  size_t cov_offset;  //!< Covariance matrix index of bin 1
+  size_t cov_stride;  //!< Covariance matrix index step between bins
   LegendPos lloc;  //!< Legend location
-  double ymax;  //!< Max y range, -1 for auto
+  double ymax;  //!< Max y range, -1 for auto; set by draw when auto
+  double ymax_config;  //!< Max y range from the configuration, -1 for auto
   std::string xtitle;  //!< Override x title
   std::string ytitle;  //!< Override y title
   std::string annotate;  //!< Annotation
@@ -129,6 +211,31 @@ public:
   float ytitle_offset;  //!< y axis title offset
 
 private:
+  /**
+   * Automatic y axis maximum: clears the data error bars in the displayed
+   * range and all of the MC lines.
+   *
+   * @param first First displayed bin (from 1)
+   * @param last Last displayed bin
+   */
+  double autoYmax(int first, int last) const;
+
+  /**
+   * Displayed bins: all of them, or those in the x range if one is set.
+   *
+   * @param first First bin (from 1)
+   * @param last Last bin
+   */
+  void getBins(int& first, int& last) const;
+
+  /**
+   * Draw and save the plot with the native vector renderer, bypassing ROOT
+   * graphics. Only the PDF, SVG and data outputs are written.
+   *
+   * @param filename Output filename, without extension
+   */
+  void drawNative(const std::string& filename);
+
   AxisRangeX* xranger;  //!< Axis range adjuster
 };
 
@@ -1,5 +1,7 @@
 #include <cassert>
+#include <cmath>
 #include <string>
+#include <vector>
 #include "json.hh"
 #include "TCanvas.h"
 #include "TVirtualPad.h"
@@ -9,6 +11,7 @@
 #include "Generator.h"
 #include "TLatex.h"
 #include "TH1D.h"
+#include "HistView.h"
 
 Plot2D::Plot2D(json::Value& c)
     : Plot(c), nrows(1), ncols(1), ymax(-1), subplot_config(json::TObject()) {
@@ -16,79 +19,138 @@ Plot2D::Plot2D(json::Value& c)
   nrows = c.getMember("nrows").getInteger();
   ncols = c.getMember("ncols").getInteger();
 
-  if (c.isMember("xlabel")) {
-    xlabel = c.getMember("xlabel").getString();
+  if (const json::Value* v = c.findMember("xlabel")) {
+    xlabel = v->getString();
   }
 
-  if (c.isMember("ylabel")) {
-    ylabel = c.getMember("ylabel").getString();
+  if (const json::Value* v = c.findMember("ylabel")) {
+    ylabel = v->getString();
   }
 
   legend_pad = 1;
-  if (c.isMember("legend_pad")) {
-    legend_pad = c.getMember("legend_pad").getInteger();
+  if (const json::Value* v = c.findMember("legend_pad")) {
+    legend_pad = v->getInteger();
   }
 
-  if (c.isMember("subplot")) {
-    subplot_config = c.getMember("subplot");
+  if (const json::Value* v = c.findMember("subplot")) {
+    subplot_config = *v;
   }
 
-  if (c.isMember("annotate")) {
-    annotate = c.getMember("annotate").toVector<std::string>();
+  if (const json::Value* v = c.findMember("annotate")) {
+    annotate = v->toVector<std::string>();
+  }
+}
+
+
+Plot2D::~Plot2D() {
+  clear();
+}
+
+
+void Plot2D::clear() {
+  for (Plot1D* plot : plots) {
+    delete plot;
+  }
+  plots.clear();
+}
+
+
+json::Value Plot2D::exportPanels(std::vector<double>& columns) const {
+  std::vector<json::Value> panels;
+  for (Plot1D* plot : plots) {
+    panels.push_back(plot->exportPanel(columns));
+  }
+  return json::Value(panels);
+}
+
+
+std::vector<std::pair<std::string, std::string> > Plot2D::legendChi2() const {
+  std::vector<std::pair<std::string, std::string> > chi2;
+  if (plots.empty()) return chi2;
+
+  // A recomputed chi2 differs from slice to slice
+  for (Plot1D* plot : plots) {
+    if (plot->chi2_range) return chi2;
+  }
+  return plots[0]->legendChi2();
+}
+
+
+void Plot2D::checkSlices(const std::string& gen_title, size_t nfound,
+                         int& nslices, std::vector<std::string>& problems) const {
+  if (nfound == 0) {
+    problems.push_back(gen_title + ": No slices found");
+  }
+
+  if (nfound > nrows * ncols) {
+    problems.push_back(gen_title + Form(": %lu slices do not fit in a %ux%u grid",
+                                        nfound, nrows, ncols));
+  }
+
+  if (!annotate.empty() && nfound != annotate.size()) {
+    problems.push_back(gen_title + Form(": %lu slices but %lu annotations",
+                                        nfound, annotate.size()));
+  }
+
+  if (nslices < 0) {
+    nslices = nfound;
+  }
+  else if (nfound != (size_t) nslices) {
+    problems.push_back(gen_title + Form(": %lu slices, expected %i", nfound, nslices));
   }
 }
 
 
 void Plot2D::draw(std::string filename, TVirtualPad* pad) {
-  // Canvas setup
-  bool own_pad = false;
+  // Canvas setup. A canvas of our own comes already divided into the grid;
+  // a pad from the caller is divided here.
+  TCanvas* canvas = nullptr;
   if (!pad) {
-    pad = new TCanvas("c", "", 2000, 1500);
-    assert(pad);
+    pad = canvas = getCanvas(2000, 1500, ncols, nrows);
     pad->SetLeftMargin(0.22);
     pad->SetTopMargin(0.18);
     pad->SetBottomMargin(0.18);
     pad->SetFillStyle(4000);
     pad->SetFrameFillStyle(0);
-    own_pad = true;
   }
 
   pad->cd();
-  pad->Divide(ncols, nrows, 0, 0);
+  if (!canvas) {
+    pad->Divide(ncols, nrows, 0, 0);
+  }
 
   // Scale
   for (auto plot : plots) {
     plot->scale(scale_factor);
   }
 
-  // Axis labels
+  // Axis labels. DrawLatexNDC draws a copy owned by the pad, so these are
+  // only templates.
   pad->cd(0);
-  TLatex* label_x = new TLatex;
-  label_x->SetTextFont(133);
-  label_x->SetTextAlign(21);
-  label_x->SetTextSize(fontsize);
-  label_x->DrawLatexNDC(0.5, 0.02, xlabel.c_str());
-
-  TLatex* label_y = new TLatex;
-  label_y->SetTextFont(133);
-  label_y->SetTextAngle(90);
-  label_y->SetTextAlign(23);
-  label_y->SetTextSize(fontsize);
-  label_y->DrawLatexNDC(0.01, 0.5, ylabel.c_str());
-
-  // Auto-scale the y axis
+  TLatex label_x;
+  label_x.SetTextFont(133);
+  label_x.SetTextAlign(21);
+  label_x.SetTextSize(fontsize);
+  label_x.DrawLatexNDC(0.5, 0.02, xlabel.c_str());
+
+  TLatex label_y;
+  label_y.SetTextFont(133);
+  label_y.SetTextAngle(90);
+  label_y.SetTextAlign(23);
+  label_y.SetTextSize(fontsize);
+  label_y.DrawLatexNDC(0.01, 0.5, ylabel.c_str());
+
+  // Auto-scale the y axis, from one pass over each data histogram
   float ymax = -999;
+  std::vector<BinStats> stats(plots.size());
   for (int i=0; i<plots.size(); i++) {
     float this_ymax = -999;
     if (plots[i]->ymax > 0) {
       this_ymax = plots[i]->ymax;
     }
     else {
-      TH1D* h = plots[i]->hdata;
-      for (int j=1; j<h->GetNbinsX()+1; j++) {
-        float v = (h->GetBinContent(j) + h->GetBinError(j)) * 1.05;
-        this_ymax = std::max(this_ymax, v);
-      }
+      stats[i] = makeView(plots[i]->hdata).stats();
+      this_ymax = std::max<float>(this_ymax, stats[i].max_plus_error * 1.05);
     }
     ymax = std::max(ymax, this_ymax);
   }
@@ -98,17 +160,13 @@ void Plot2D::draw(std::string filename, TVirtualPad* pad) {
 
     plots[i]->ymax = ymax;
 
-    TH1D* h = plots[i]->hdata;
-    h->GetYaxis()->SetNoExponent();
-    float this_ymax = (h->GetMaximum() + h->GetBinError(h->GetMaximumBin())) * 1.05;
+    plots[i]->hdata->GetYaxis()->SetNoExponent();
+    float this_ymax = (stats[i].max + std::sqrt(stats[i].max_error2)) * 1.05;
 
     std::vector<float> scales = { 50, 20, 10, 5, 2 };
     for (float yscale : scales) {
       if (this_ymax * yscale < ymax) {
-        h->Scale(yscale);
-        for (TH1D* line : plots[i]->lines) {
-          line->Scale(yscale);
-        }
+        plots[i]->scale(yscale);
         plots[i]->annotate += Form(";#times%1.0f", yscale);
         break;
       }
@@ -129,14 +187,11 @@ void Plot2D::draw(std::string filename, TVirtualPad* pad) {
   }
 
   // Save the final canvas
-  if (filename != "") {
-    pad->SaveAs((filename + ".pdf").c_str());
-    pad->SaveAs((filename + ".C").c_str());
-  }
+  save(pad, filename);
 
-  // Delete the canvas if we own it
-  if (own_pad) {
-    delete pad;
+  // Done with the canvas, if it is ours
+  if (canvas) {
+    releaseCanvas(canvas);
   }
 }
 
@@ -25,6 +25,9 @@ public:
    */
   Plot2D(json::Value& c);
 
+  /** Destructor. */
+  virtual ~Plot2D();
+
   /**
    * Add a generator to the plot.
    *
@@ -39,6 +42,28 @@ public:
    */
   virtual void draw(std::string filename="", TVirtualPad* pad=nullptr);
 
+  /** Delete the subplots and their histograms. */
+  virtual void clear();
+
+  /** Describe the plotted data for export, one panel per subplot. */
+  virtual json::Value exportPanels(std::vector<double>& columns) const;
+
+  /** The chi2/ndof in the legends, unless it is recomputed per slice. */
+  virtual std::vector<std::pair<std::string, std::string> > legendChi2() const;
+
+protected:
+  /**
+   * Check a generator's slice count against the grid, the annotations and
+   * the other generators.
+   *
+   * @param gen_title Generator title, for messages
+   * @param nfound Number of slices found for this generator
+   * @param nslices Number of slices in earlier generators, -1 if none yet
+   * @param problems List to append problems to
+   */
+  void checkSlices(const std::string& gen_title, size_t nfound, int& nslices,
+                   std::vector<std::string>& problems) const;
+
 public:
   unsigned nrows;  //!< Number of plot grid rows
   unsigned ncols;  //!< Number of plot grid columns
@@ -46,7 +71,7 @@ public:
   float ymax;  //!< Maximum y, -1 for auto scale
   std::string xlabel;  //!< x axis label
   std::string ylabel;  //!< y axis label
-  std::vector<Plot1D*> plots;  //!< Array of plots for the 2D grid
+  std::vector<Plot1D*> plots;  //!< Array of plots for the 2D grid (owned)
   Plot1D::LegendPos lloc;  //!< Legend location
   json::Value subplot_config;  //!< Config applied to subplots
   std::vector<std::string> annotate;  //!< Subplot annotations
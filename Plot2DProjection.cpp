@@ -9,10 +9,11 @@
 #include "Plot2D.h"
 #include "Plot2DProjection.h"
 #include "Generator.h"
+#include "HistView.h"
 
 Plot2DProjection::Plot2DProjection(json::Value& c) : Plot2D(c), nslices(-1) {
   // Load settings
-  std::string sproj = c.getMember("projection").getString();
+  const std::string& sproj = c.getMember("projection").getString();
 
   if (sproj == "x") {
     projection = kX;
@@ -26,16 +27,61 @@ Plot2DProjection::Plot2DProjection(json::Value& c) : Plot2D(c), nslices(-1) {
 }
 
 
+std::vector<std::string> Plot2DProjection::getKeys(Generator* gen, bool data_source) const {
+  std::vector<std::string> keys;
+  const SampleCatalog::Entry* entry = gen->catalog.find(sample);
+  if (entry) {
+    if (!entry->mc.empty()) keys.push_back(entry->mc);
+    if (data_source && !entry->data.empty()) keys.push_back(entry->data);
+    if (data_source && chi2_range && !entry->covariance.empty()) {
+      keys.push_back(entry->covariance);
+    }
+  }
+  return keys;
+}
+
+
+std::vector<std::string> Plot2DProjection::check(const std::vector<Generator*>& gens) const {
+  std::vector<std::string> problems;
+  int n = -1;
+  for (Generator* gen : gens) {
+    const SampleCatalog::Entry* entry = gen->catalog.find(sample);
+    if (!entry || entry->mc.empty() || entry->data.empty()) {
+      problems.push_back(gen->title + ": No MC and data histograms");
+      continue;
+    }
+
+    // The slice count comes from the binning, so the histograms must be read
+    HistCache::Handle mc_handle = gen->getShared(entry->mc);
+    HistCache::Handle data_handle = gen->getShared(entry->data);
+    const TH2D* mc2d = dynamic_cast<const TH2D*>(mc_handle.get());
+    const TH2D* data2d = dynamic_cast<const TH2D*>(data_handle.get());
+    if (!mc2d || !data2d) {
+      problems.push_back(gen->title + ": MC and data are not both TH2D");
+      continue;
+    }
+
+    if (mc2d->GetNbinsX() != data2d->GetNbinsX() ||
+        mc2d->GetNbinsY() != data2d->GetNbinsY()) {
+      problems.push_back(gen->title + ": MC and data binning differ");
+    }
+
+    size_t nfound = (projection == kX) ? mc2d->GetNbinsY() : mc2d->GetNbinsX();
+    checkSlices(gen->title, nfound, n, problems);
+  }
+  return problems;
+}
+
+
 void Plot2DProjection::add(Generator* gen) {
   // Load input 2D histograms
-  std::string mc_name = sample + "_MC";
-  TH2D* mc2d = (TH2D*) gen->getHistogram(mc_name);
-
-  std::string data_name = sample + "_data";
-  TH2D* data2d = (TH2D*) gen->getHistogram(data_name);
+  const SampleCatalog::Entry* entry = gen->catalog.find(sample);
+  assert(entry);
 
-  assert((mc2d->GetNbinsX() == data2d->GetNbinsX()) &&
-         (mc2d->GetNbinsY() == data2d->GetNbinsY()));
+  // These are only read from, so use the shared copies
+  HistCache::Handle mc_handle = gen->getShared(entry->mc);
+  const TH2D* mc2d = dynamic_cast<const TH2D*>(mc_handle.get());
+  assert(mc2d);
 
   size_t nfound = (projection == kX) ? mc2d->GetNbinsY() : mc2d->GetNbinsX();
 
@@ -56,18 +102,26 @@ void Plot2DProjection::add(Generator* gen) {
     assert(nfound == annotate.size());
   }
 
-  // Set axis labels automatically
-  if (ylabel.empty()) {
-    ylabel = data2d->GetZaxis()->GetTitle();
-  }
+  // Populate initial slice plots. The data are read from the first
+  // generator only.
+  if (plots.empty()) {
+    HistCache::Handle data_handle = gen->getShared(entry->data);
+    const TH2D* data2d = dynamic_cast<const TH2D*>(data_handle.get());
+    assert(data2d);
 
-  if (xlabel.empty()) {
-    xlabel = (projection == kX ? data2d->GetXaxis()->GetTitle()
-                               : data2d->GetYaxis()->GetTitle());
-  }
+    assert((mc2d->GetNbinsX() == data2d->GetNbinsX()) &&
+           (mc2d->GetNbinsY() == data2d->GetNbinsY()));
+
+    // Set axis labels automatically
+    if (ylabel.empty()) {
+      ylabel = data2d->GetZaxis()->GetTitle();
+    }
+
+    if (xlabel.empty()) {
+      xlabel = (projection == kX ? data2d->GetXaxis()->GetTitle()
+                                 : data2d->GetYaxis()->GetTitle());
+    }
 
-  // Populate initial slice plots
-  if (plots.empty()) {
     plots.resize(nslices);
     for (size_t i=0; i<nslices; i++) {
       if (!annotate.empty()) {
@@ -75,63 +129,76 @@ void Plot2DProjection::add(Generator* gen) {
       }
       subplot_config.setMember("fontsize", json::Value(fontsize));
       plots[i] = new Plot1D(subplot_config);
+      plots[i]->chi2_range |= chi2_range;
 
       std::string proj = (projection == kX ? "x" : "y");
       std::string name = Form("%s_slice_%lu_%s_h", data2d->GetName(), i, proj.c_str());
 
       TH1D* h;
       if (projection == kX) {
-        h = (TH1D*) data2d->ProjectionX(name.c_str(), i+1, i+1);
+        h = makeTH1D(makeViewX(data2d, i+1), name);
+
+        // The covariance is indexed by global bin without under/overflow,
+        // x fastest
+        plots[i]->cov_offset = i * data2d->GetNbinsX();
+
+        std::string xtitle = data2d->GetYaxis()->GetTitle();
+        float xlo = data2d->GetYaxis()->GetBinLowEdge(i+1);
+        float xwd = data2d->GetYaxis()->GetBinWidth(i+1);
+        float xhi = xlo + xwd;
+        plots[i]->slice = { xlo, xhi };
+        plots[i]->slice_title = xtitle;
 
         if (annotate.empty()) {
-          std::string xtitle = data2d->GetYaxis()->GetTitle();
-          float xlo = data2d->GetYaxis()->GetBinLowEdge(i+1);
-          float xwd = data2d->GetYaxis()->GetBinWidth(i+1);
-          float xhi = xlo + xwd;
           std::string label = Form("%1.2f < %s < %1.2f", xlo, xtitle.c_str(), xhi);
           plots[i]->annotate = label;
         }
       }
       else {
-        h = (TH1D*) data2d->ProjectionY(name.c_str(), i+1, i+1);
+        h = makeTH1D(makeViewY(data2d, i+1), name);
+        plots[i]->cov_offset = i;
+        plots[i]->cov_stride = data2d->GetNbinsX();
+
+        std::string xtitle = data2d->GetXaxis()->GetTitle();
+        float xlo = data2d->GetXaxis()->GetBinLowEdge(i+1);
+        float xwd = data2d->GetXaxis()->GetBinWidth(i+1);
+        float xhi = xlo + xwd;
+        plots[i]->slice = { xlo, xhi };
+        plots[i]->slice_title = xtitle;
 
         if (annotate.empty()) {
-          std::string xtitle = data2d->GetXaxis()->GetTitle();
-          float xlo = data2d->GetXaxis()->GetBinLowEdge(i+1);
-          float xwd = data2d->GetXaxis()->GetBinWidth(i+1);
-          float xhi = xlo + xwd;
           std::string label = Form("%1.2f < %s < %1.2f", xlo, xtitle.c_str(), xhi);
           plots[i]->annotate = label;
         }
       }
 
-      h->GetXaxis()->SetTitle("");
-      h->GetYaxis()->SetTitle("");
       h->SetLineColor(kBlack);
       h->SetLineWidth(1);
       if (ymax > -1) {
         plots[i]->ymax = ymax;
       }
       plots[i]->hdata = h;
+      plots[i]->data_gen = gen;
     }
   }
 
-  // Add MC histograms
+  // Add MC histograms, built directly from slices of the shared 2D histogram
   for (size_t i=0; i<nslices; i++) {
     std::string name = Form("%s_slice_%lu_h", mc2d->GetName(), i);
 
     TH1D* hmc;
     if (projection == kX) {
-      hmc = (TH1D*) mc2d->ProjectionX(name.c_str(), i+1, i+1);
+      hmc = makeTH1D(makeViewX(mc2d, i+1), name);
     }
     else {
-      hmc = (TH1D*) mc2d->ProjectionY(name.c_str(), i+1, i+1);
+      hmc = makeTH1D(makeViewY(mc2d, i+1), name);
     }
 
     std::string title = gen->title + " (#chi^{2}=" + gen->getChi2String(sample) + ")";
     hmc->SetTitle(title.c_str());
+    hmc->SetLineColor(gen->color);
     hmc->SetLineWidth(1);
-    plots[i]->lines.push_back(hmc);
+    plots[i]->addLine(hmc, gen, sample);
   }
 }
 
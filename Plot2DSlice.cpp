@@ -10,26 +10,52 @@
 #include "Plot2DSlice.h"
 #include "Generator.h"
 
-void Plot2DSlice::add(Generator* gen) {
-  // Discover slices by looping over available keys. Note: The case for these
-  // keys is not consistent across measurements.
-  std::string mc_name = sample + "_MC_Slice";
-  std::string mc_name_lower = sample + "_mc_slice";
-
-  std::string data_name = sample + "_data_Slice";
-  std::string data_name_lower = sample + "_data_slice";
+std::vector<std::string> Plot2DSlice::getKeys(Generator* gen, bool data_source) const {
+  std::vector<std::string> keys;
+  const SampleCatalog::Entry* entry = gen->catalog.find(sample);
+  if (entry) {
+    keys.insert(keys.end(), entry->mc_slices.begin(), entry->mc_slices.end());
+    if (data_source) {
+      keys.insert(keys.end(), entry->data_slices.begin(), entry->data_slices.end());
+    }
+    if (data_source && chi2_range && !entry->covariance.empty()) {
+      keys.push_back(entry->covariance);
+    }
+  }
+  return keys;
+}
 
-  std::vector<std::string> mc_slice_objs;
-  std::vector<std::string> data_slice_objs;
 
-  for (std::string& key : gen->keys) {
-    if (key.rfind(mc_name, 0) == 0 || key.rfind(mc_name_lower, 0) == 0) {
-      mc_slice_objs.push_back(key);
+std::vector<std::string> Plot2DSlice::check(const std::vector<Generator*>& gens) const {
+  std::vector<std::string> problems;
+  int n = -1;
+  for (Generator* gen : gens) {
+    const SampleCatalog::Entry* entry = gen->catalog.find(sample);
+    if (!entry) {
+      problems.push_back(gen->title + ": No slices found");
+      continue;
     }
-    if (key.rfind(data_name, 0) == 0 || key.rfind(data_name_lower, 0) == 0) {
-      data_slice_objs.push_back(key);
+
+    size_t nmc = entry->mc_slices.size();
+    size_t ndata = entry->data_slices.size();
+    if (nmc != ndata) {
+      problems.push_back(gen->title + Form(": %lu MC slices but %lu data slices", nmc, ndata));
     }
+
+    checkSlices(gen->title, nmc, n, problems);
   }
+  return problems;
+}
+
+
+void Plot2DSlice::add(Generator* gen) {
+  // Slices are discovered and sorted when the generator is loaded. Note: The
+  // case for these keys is not consistent across measurements.
+  const SampleCatalog::Entry* entry = gen->catalog.find(sample);
+  assert(entry);
+
+  const std::vector<std::string>& mc_slice_objs = entry->mc_slices;
+  const std::vector<std::string>& data_slice_objs = entry->data_slices;
 
   assert(mc_slice_objs.size() == data_slice_objs.size());
   size_t nfound = mc_slice_objs.size();
@@ -51,13 +77,10 @@ void Plot2DSlice::add(Generator* gen) {
     assert(nfound == annotate.size());
   }
 
-  // Sort by name
-  std::sort(mc_slice_objs.begin(), mc_slice_objs.end());
-  std::sort(data_slice_objs.begin(), data_slice_objs.end());
-
   // Populate initial slice plots
   if (plots.empty()) {
     plots.resize(nslices);
+    size_t cov_offset = 0;  // The covariance covers the slices in order
     for (size_t i=0; i<nslices; i++) {
       if (!annotate.empty()) {
         json::Value va(annotate[i]);
@@ -66,7 +89,10 @@ void Plot2DSlice::add(Generator* gen) {
       json::Value vf(fontsize);
       subplot_config.setMember("fontsize", vf);
       plots[i] = new Plot1D(subplot_config);
+      plots[i]->chi2_range |= chi2_range;
       TH1D* h = (TH1D*) gen->getHistogram(data_slice_objs[i]);
+      plots[i]->cov_offset = cov_offset;
+      cov_offset += h->GetNbinsX();
       h->SetLineColor(kBlack);
       h->SetLineWidth(1);
       if (ymax > -1) {
@@ -85,6 +111,7 @@ void Plot2DSlice::add(Generator* gen) {
       h->GetYaxis()->SetTitle("");
 
       plots[i]->hdata = h;
+      plots[i]->data_gen = gen;
     }
   }
 
@@ -94,7 +121,7 @@ void Plot2DSlice::add(Generator* gen) {
     std::string title = gen->title + " (#chi^{2}=" + gen->getChi2String(sample) + ")";
     hmc->SetTitle(title.c_str());
     hmc->SetLineWidth(1);
-    plots[i]->lines.push_back(hmc);
+    plots[i]->addLine(hmc, gen, sample);
   }
 }
 
@@ -26,6 +26,24 @@ public:
    */
   void add(Generator* gen);
 
+  /**
+   * List the objects that `add` will read from a generator.
+   *
+   * @param gen The Generator
+   * @param data_source True if the plot's data are read from this generator
+   * @returns Names of the objects
+   */
+  std::vector<std::string> getKeys(Generator* gen, bool data_source) const;
+
+  /**
+   * Check that the plot can be built from a set of generators, without
+   * drawing anything.
+   *
+   * @param gens The generators that will be added
+   * @returns A description of each problem found
+   */
+  std::vector<std::string> check(const std::vector<Generator*>& gens) const;
+
 private:
   int nslices;  //!< Number of slices for subplots
 };
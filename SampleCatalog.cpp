@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SampleCatalog.h"
+
+namespace {
+
+/** Check whether a string ends with a suffix. */
+bool endsWith(const std::string& s, const std::string& suffix) {
+  return (s.size() > suffix.size() &&
+          s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+/**
+ * Find a slice marker in a key.
+ *
+ * @returns Position of the last matching marker, or npos
+ */
+size_t findMarker(const std::string& key, const char* upper, const char* lower) {
+  size_t pos = key.rfind(upper);
+  if (pos == std::string::npos) {
+    pos = key.rfind(lower);
+  }
+  return (pos == 0 ? std::string::npos : pos);
+}
+
+}  // namespace
+
+
+SampleCatalog::SampleCatalog(const std::vector<std::string>& keys) {
+  // Priority of the key used as data, lower is better
+  std::unordered_map<std::string, int> data_rank;
+
+  for (const std::string& key : keys) {
+    size_t pos;
+
+    if ((pos = findMarker(key, "_MC_Slice", "_mc_slice")) != std::string::npos) {
+      entries[key.substr(0, pos)].mc_slices.push_back(key);
+    }
+    else if ((pos = findMarker(key, "_data_Slice", "_data_slice")) != std::string::npos) {
+      entries[key.substr(0, pos)].data_slices.push_back(key);
+    }
+    else if (endsWith(key, "_MC")) {
+      entries[key.substr(0, key.size() - 3)].mc = key;
+    }
+    else if (endsWith(key, "_COV") || endsWith(key, "_cov")) {
+      entries[key.substr(0, key.size() - 4)].covariance = key;
+    }
+    else {
+      std::string sample = key;
+      int rank = 2;
+      if (endsWith(key, "_data")) {
+        sample = key.substr(0, key.size() - 5);
+        rank = 0;
+      }
+      else if (endsWith(key, "_DATA")) {
+        sample = key.substr(0, key.size() - 5);
+        rank = 1;
+      }
+
+      std::unordered_map<std::string, int>::iterator it = data_rank.find(sample);
+      if (it == data_rank.end() || rank < it->second) {
+        data_rank[sample] = rank;
+        entries[sample].data = key;
+      }
+    }
+  }
+
+  for (auto& it : entries) {
+    std::sort(it.second.mc_slices.begin(), it.second.mc_slices.end(), naturalLess);
+    std::sort(it.second.data_slices.begin(), it.second.data_slices.end(), naturalLess);
+  }
+}
+
+
+const SampleCatalog::Entry* SampleCatalog::find(const std::string& sample) const {
+  std::unordered_map<std::string, Entry>::const_iterator it = entries.find(sample);
+  return (it == entries.end() ? nullptr : &it->second);
+}
+
+
+bool SampleCatalog::naturalLess(const std::string& a, const std::string& b) {
+  size_t i = 0, j = 0;
+  while (i < a.size() && j < b.size()) {
+    if (isdigit(a[i]) && isdigit(b[j])) {
+      // Compare digit runs by value: skip leading zeros, then length, then digits
+      size_t ia = i, jb = j;
+      while (ia < a.size() && a[ia] == '0') ia++;
+      while (jb < b.size() && b[jb] == '0') jb++;
+      size_t ea = ia, eb = jb;
+      while (ea < a.size() && isdigit(a[ea])) ea++;
+      while (eb < b.size() && isdigit(b[eb])) eb++;
+      if (ea - ia != eb - jb) return (ea - ia < eb - jb);
+      int c = a.compare(ia, ea - ia, b, jb, eb - jb);
+      if (c != 0) return c < 0;
+      i = ea;
+      j = eb;
+    }
+    else {
+      // Ignore case, since the slice naming is not consistent
+      int ca = tolower(a[i]), cb = tolower(b[j]);
+      if (ca != cb) return ca < cb;
+      i++;
+      j++;
+    }
+  }
+  return (a.size() - i < b.size() - j);
+}
+
@@ -0,0 +1,72 @@
+#ifndef __plotter_SampleCatalog__
+#define __plotter_SampleCatalog__
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class SampleCatalog
+ * @brief Index of the objects in a nuiscomp file, grouped by sample
+ *
+ * Every key is classified once, when the catalog is built. Keys are matched
+ * by suffix:
+ *
+ *   <sample>_MC                  MC histogram
+ *   <sample>_data, <sample>_DATA Data histogram
+ *   <sample>_MC_Slice*           MC slices (also _mc_slice)
+ *   <sample>_data_Slice*         Data slices (also _data_slice)
+ *   <sample>_COV, <sample>_cov   Covariance matrix
+ *
+ * Any other key is treated as a data histogram named after the sample, which
+ * is used only if there is no _data or _DATA key. Slices are sorted in
+ * natural order, so that e.g. Slice2 comes before Slice10.
+ */
+class SampleCatalog {
+public:
+  /**
+   * @struct Entry
+   * @brief Object names for one sample
+   */
+  struct Entry {
+    std::string data;  //!< Data histogram key, empty if none
+    std::string mc;  //!< MC histogram key, empty if none
+    std::string covariance;  //!< Covariance matrix key, empty if none
+    std::vector<std::string> data_slices;  //!< Data slice keys, in order
+    std::vector<std::string> mc_slices;  //!< MC slice keys, in order
+  };
+
+  /** Default ctor. */
+  SampleCatalog() {}
+
+  /**
+   * Constructor with a list of keys.
+   *
+   * @param keys Names of all objects in the file
+   */
+  SampleCatalog(const std::vector<std::string>& keys);
+
+  /**
+   * Look up a sample.
+   *
+   * @param sample Name of the NUISANCE sample
+   * @returns The catalog entry, or nullptr if the sample is unknown
+   */
+  const Entry* find(const std::string& sample) const;
+
+  /**
+   * Compare strings in natural order, treating runs of digits as numbers
+   * and ignoring case.
+   *
+   * @param a First string
+   * @param b Second string
+   * @returns True if a sorts before b
+   */
+  static bool naturalLess(const std::string& a, const std::string& b);
+
+private:
+  std::unordered_map<std::string, Entry> entries;  //!< Entries by sample
+};
+
+#endif  // __plotter_SampleCatalog__
+
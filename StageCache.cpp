@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "Hash.h"
+#include "StageCache.h"
+
+namespace {
+
+/** Modification time in nanoseconds, used to order files by last use. */
+uint64_t mtimeNs(const struct stat& st) {
+#ifdef __APPLE__
+  return uint64_t(st.st_mtimespec.tv_sec) * 1000000000ULL + st.st_mtimespec.tv_nsec;
+#else
+  return uint64_t(st.st_mtim.tv_sec) * 1000000000ULL + st.st_mtim.tv_nsec;
+#endif
+}
+
+
+/** Prefix for the names of staged files. */
+const char* kPrefix = "stage_";
+
+}  // namespace
+
+
+StageCache::StageCache(const std::string& _dir, uint64_t _max_bytes)
+    : dir(_dir), max_bytes(_max_bytes) {
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    perror(("StageCache: " + dir).c_str());
+  }
+}
+
+
+std::string StageCache::stage(const std::string& path) {
+  // Pass through URLs, and anything we cannot stat
+  if (path.find("://") != std::string::npos) return path;
+
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return path;
+  if ((uint64_t) st.st_size > max_bytes) return path;
+
+  // Name the copy after the source identity, keeping the original file name
+  // (and extension) for readability
+  char* abspath = realpath(path.c_str(), nullptr);
+  std::string id = (abspath ? abspath : path);
+  free(abspath);
+  id += ":" + std::to_string(st.st_size) + ":" + std::to_string(st.st_mtime);
+
+  std::string hash = Hash().add(id.data(), id.size()).hex();
+  std::string basename = path.substr(path.rfind('/') + 1);
+  std::string local = dir + "/" + kPrefix + hash + "_" + basename;
+
+  // Hit: mark as recently used
+  struct stat lst;
+  if (stat(local.c_str(), &lst) == 0 && lst.st_size == st.st_size) {
+    utimes(local.c_str(), nullptr);
+    used.insert(local);
+    return local;
+  }
+
+  // Make room first. If the files already in use leave too little, read
+  // from the source instead.
+  if (!evict(st.st_size)) {
+    std::cout << "Not staging " << path << ": staging area is full" << std::endl;
+    return path;
+  }
+
+  std::cout << "Staging " << path << " to " << local << std::endl;
+  if (!copy(path, local)) {
+    return path;
+  }
+
+  used.insert(local);
+  return local;
+}
+
+
+bool StageCache::evict(uint64_t reserve) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) return false;
+
+  // List staged files that may be removed, oldest use first. Files in use
+  // only count towards the total.
+  struct Entry {
+    std::string path;
+    uint64_t size;
+    uint64_t mtime;
+  };
+  std::vector<Entry> entries;
+  uint64_t total = 0;
+
+  struct dirent* de;
+  while ((de = readdir(d)) != nullptr) {
+    std::string name = de->d_name;
+    if (name.compare(0, strlen(kPrefix), kPrefix) != 0) continue;
+
+    std::string p = dir + "/" + name;
+    struct stat st;
+    if (stat(p.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+    total += st.st_size;
+    if (!used.count(p)) {
+      entries.push_back({ p, (uint64_t) st.st_size, mtimeNs(st) });
+    }
+  }
+  closedir(d);
+
+  total += reserve;
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) { return a.mtime < b.mtime; });
+
+  for (size_t i=0; i<entries.size() && total > max_bytes; i++) {
+    if (unlink(entries[i].path.c_str()) == 0) {
+      total -= entries[i].size;
+    }
+  }
+
+  return total <= max_bytes;
+}
+
+
+bool StageCache::copy(const std::string& src, const std::string& dst) {
+  // Write to a temporary name, then rename, so that concurrent runs never see
+  // a partial file. Temporaries lack the prefix and are ignored by evict.
+  std::string tmp = dir + "/.tmp." + std::to_string(getpid()) + "." +
+                    dst.substr(dst.rfind('/') + 1);
+
+  int in = open(src.c_str(), O_RDONLY);
+  if (in < 0) {
+    perror(("StageCache: " + src).c_str());
+    return false;
+  }
+
+  int out = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out < 0) {
+    perror(("StageCache: " + tmp).c_str());
+    close(in);
+    return false;
+  }
+
+  std::vector<char> buffer(4 * 1024 * 1024);
+  bool ok = true;
+  for (;;) {
+    ssize_t n = read(in, buffer.data(), buffer.size());
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      ok = (n == 0);
+      break;
+    }
+
+    ssize_t off = 0;
+    while (off < n) {
+      ssize_t m = write(out, buffer.data() + off, n - off);
+      if (m < 0 && errno == EINTR) continue;
+      if (m < 0) {
+        ok = false;
+        break;
+      }
+      off += m;
+    }
+    if (!ok) break;
+  }
+
+  close(in);
+  ok = (close(out) == 0) && ok;
+
+  if (!ok || rename(tmp.c_str(), dst.c_str()) != 0) {
+    perror(("StageCache: " + dst).c_str());
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  return true;
+}
+
@@ -0,0 +1,67 @@
+#ifndef __plotter_StageCache__
+#define __plotter_StageCache__
+
+#include <cstdint>
+#include <set>
+#include <string>
+
+/**
+ * @class StageCache
+ * @brief Local disk cache for generator files on slow or remote storage
+ *
+ * Files are copied into a local directory under a name derived from their
+ * path, size and modification time, so a changed source file is staged again
+ * rather than served stale. When the directory grows past its size limit,
+ * the least recently used copies are removed. Copies handed out by this
+ * instance are never removed, since the caller may still open them.
+ *
+ * Only paths on a mounted filesystem (including NFS or dCache mounts) are
+ * staged; URLs such as root://... are passed through unchanged.
+ */
+class StageCache {
+public:
+  /**
+   * Constructor.
+   *
+   * @param _dir Cache directory (created if needed)
+   * @param _max_bytes Maximum total size of staged files
+   */
+  StageCache(const std::string& _dir, uint64_t _max_bytes);
+
+  /**
+   * Get a local copy of a file, staging it if needed.
+   *
+   * @param path Path to the source file
+   * @returns Path to the local copy, or the original path if the file could
+   *          not be staged
+   */
+  std::string stage(const std::string& path);
+
+  /**
+   * Remove least recently used files until the cache fits its limit, with
+   * room to spare. Files returned by `stage` are kept.
+   *
+   * @param reserve Bytes to make room for
+   * @returns True if the cache, plus the reserved bytes, fits the limit
+   */
+  bool evict(uint64_t reserve=0);
+
+public:
+  std::string dir;  //!< Cache directory
+  uint64_t max_bytes;  //!< Maximum total size of staged files
+
+private:
+  std::set<std::string> used;  //!< Staged files returned by this instance
+
+  /**
+   * Copy a file atomically into the cache.
+   *
+   * @param src Source path
+   * @param dst Destination path
+   * @returns True on success
+   */
+  bool copy(const std::string& src, const std::string& dst);
+};
+
+#endif  // __plotter_StageCache__
+
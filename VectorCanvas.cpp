@@ -0,0 +1,674 @@
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "VectorCanvas.h"
+
+namespace {
+
+/** Times-Roman character widths (1/1000 em) for ASCII 32-126. */
+const short kTimesWidths[95] = {
+  250, 333, 408, 500, 500, 833, 778, 333, 333, 333, 500, 564, 250, 333, 250, 278,
+  500, 500, 500, 500, 500, 500, 500, 500, 500, 500,
+  278, 278, 564, 564, 564, 444, 921,
+  722, 667, 667, 722, 611, 556, 722, 722, 333, 389, 722, 611, 889, 722, 722, 556,
+  722, 667, 556, 611, 722, 722, 944, 722, 722, 611,
+  333, 278, 333, 469, 500, 333,
+  444, 500, 444, 500, 444, 333, 500, 500, 278, 278, 500, 278, 778, 500, 500, 500,
+  500, 333, 389, 278, 500, 500, 722, 500, 500, 444,
+  480, 200, 480, 541
+};
+
+
+/** A TLatex command and the character it stands for. */
+struct LatexSymbol {
+  const char* name;  //!< Command name, without the leading #
+  uint32_t cp;  //!< Unicode code point
+  char symbol;  //!< Code in the PDF Symbol font, 0 if not needed
+};
+
+const LatexSymbol kLatexSymbols[] = {
+  { "alpha", 0x03b1, 'a' }, { "beta", 0x03b2, 'b' }, { "gamma", 0x03b3, 'g' },
+  { "delta", 0x03b4, 'd' }, { "epsilon", 0x03b5, 'e' }, { "zeta", 0x03b6, 'z' },
+  { "eta", 0x03b7, 'h' }, { "theta", 0x03b8, 'q' }, { "iota", 0x03b9, 'i' },
+  { "kappa", 0x03ba, 'k' }, { "lambda", 0x03bb, 'l' }, { "mu", 0x03bc, 'm' },
+  { "nu", 0x03bd, 'n' }, { "xi", 0x03be, 'x' }, { "omicron", 0x03bf, 'o' },
+  { "pi", 0x03c0, 'p' }, { "rho", 0x03c1, 'r' }, { "sigma", 0x03c3, 's' },
+  { "tau", 0x03c4, 't' }, { "upsilon", 0x03c5, 'u' }, { "phi", 0x03c6, 'f' },
+  { "chi", 0x03c7, 'c' }, { "psi", 0x03c8, 'y' }, { "omega", 0x03c9, 'w' },
+  { "Gamma", 0x0393, 'G' }, { "Delta", 0x0394, 'D' }, { "Theta", 0x0398, 'Q' },
+  { "Lambda", 0x039b, 'L' }, { "Xi", 0x039e, 'X' }, { "Pi", 0x03a0, 'P' },
+  { "Sigma", 0x03a3, 'S' }, { "Phi", 0x03a6, 'F' }, { "Psi", 0x03a8, 'Y' },
+  { "Omega", 0x03a9, 'W' },
+  { "times", 0x00d7, 0 }, { "pm", 0x00b1, 0 }, { "cdot", 0x00b7, 0 },
+  { "circ", 0x00b0, 0 }, { "leq", 0x2264, char(0xa3) }, { "geq", 0x2265, char(0xb3) },
+  { "rightarrow", 0x2192, char(0xae) }, { "infty", 0x221e, char(0xa5) },
+  { "approx", 0x2248, char(0xbb) }, { "neq", 0x2260, char(0xb9) },
+  { "sim", 0x223c, '~' }
+};
+
+
+/** Unicode superscript and subscript forms of 0-9, +, -, =, (, ). */
+const char kScriptChars[] = "0123456789+-=()";
+const uint32_t kSuperscripts[] = {
+  0x2070, 0x00b9, 0x00b2, 0x00b3, 0x2074, 0x2075, 0x2076, 0x2077, 0x2078, 0x2079,
+  0x207a, 0x207b, 0x207c, 0x207d, 0x207e
+};
+const uint32_t kSubscripts[] = {
+  0x2080, 0x2081, 0x2082, 0x2083, 0x2084, 0x2085, 0x2086, 0x2087, 0x2088, 0x2089,
+  0x208a, 0x208b, 0x208c, 0x208d, 0x208e
+};
+
+
+/** Append a code point to a UTF-8 string. */
+void appendUtf8(std::string& out, uint32_t cp) {
+  if (cp < 0x80) {
+    out += char(cp);
+  }
+  else if (cp < 0x800) {
+    out += char(0xc0 | (cp >> 6));
+    out += char(0x80 | (cp & 0x3f));
+  }
+  else {
+    out += char(0xe0 | (cp >> 12));
+    out += char(0x80 | ((cp >> 6) & 0x3f));
+    out += char(0x80 | (cp & 0x3f));
+  }
+}
+
+
+/** Decode the code point starting at s[i], and advance i past it. */
+uint32_t nextCodePoint(const std::string& s, size_t& i) {
+  unsigned char c = s[i++];
+  if (c < 0x80) return c;
+
+  int n = (c >= 0xf0) ? 3 : (c >= 0xe0) ? 2 : 1;
+  uint32_t cp = c & (0x3f >> n);
+  for (int k=0; k<n && i<s.size(); k++) {
+    cp = (cp << 6) | (s[i++] & 0x3f);
+  }
+  return cp;
+}
+
+
+/** Index of a code point in a script table, -1 if absent. */
+int scriptIndex(const uint32_t* table, uint32_t cp) {
+  for (size_t i=0; i<sizeof(kScriptChars)-1; i++) {
+    if (table[i] == cp) return i;
+  }
+  return -1;
+}
+
+
+/**
+ * Read a TLatex argument: a braced group or a single character.
+ *
+ * @param s Input
+ * @param i Position of the argument, advanced past it
+ * @returns The argument, without braces
+ */
+std::string readArgument(const std::string& s, size_t& i) {
+  if (i >= s.size()) return "";
+
+  if (s[i] != '{') {
+    size_t start = i;
+    nextCodePoint(s, i);
+    return s.substr(start, i - start);
+  }
+
+  int depth = 0;
+  size_t start = i + 1;
+  for (; i<s.size(); i++) {
+    if (s[i] == '{') depth++;
+    else if (s[i] == '}' && --depth == 0) break;
+  }
+  std::string arg = s.substr(start, i - start);
+  if (i < s.size()) i++;
+  return arg;
+}
+
+
+/**
+ * A run of text in one PDF font: 0 for the text font (WinAnsi), 1 for
+ * Symbol.
+ */
+struct PdfRun {
+  int font;  //!< 0 for the text font, 1 for Symbol
+  std::string bytes;  //!< Encoded text
+};
+
+
+/** Encode UTF-8 text for the standard PDF fonts. */
+std::vector<PdfRun> encodePdf(const std::string& s) {
+  std::vector<PdfRun> runs;
+  auto emit = [&](int font, char c) {
+    if (runs.empty() || runs.back().font != font) {
+      runs.push_back({ font, "" });
+    }
+    runs.back().bytes += c;
+  };
+
+  size_t i = 0;
+  while (i < s.size()) {
+    uint32_t cp = nextCodePoint(s, i);
+
+    // Runs of super- or subscripts are written as ^... or _..., except for
+    // a lone superscript 1-3 which WinAnsi has
+    int super = scriptIndex(kSuperscripts, cp);
+    int sub = scriptIndex(kSubscripts, cp);
+    if (super >= 0 || sub >= 0) {
+      const uint32_t* table = (super >= 0) ? kSuperscripts : kSubscripts;
+      std::string script(1, kScriptChars[super >= 0 ? super : sub]);
+      size_t j = i;
+      while (j < s.size()) {
+        size_t k = j;
+        int idx = scriptIndex(table, nextCodePoint(s, k));
+        if (idx < 0) break;
+        script += kScriptChars[idx];
+        j = k;
+      }
+      i = j;
+
+      if (script.size() == 1 && cp < 0x100) {
+        emit(0, char(cp));
+      }
+      else {
+        emit(0, super >= 0 ? '^' : '_');
+        for (char c : script) emit(0, c);
+      }
+      continue;
+    }
+
+    if (cp < 0x100) {
+      emit(0, char(cp));
+      continue;
+    }
+
+    char symbol = '?';
+    for (const LatexSymbol& ls : kLatexSymbols) {
+      if (ls.cp == cp && ls.symbol) {
+        symbol = ls.symbol;
+        break;
+      }
+    }
+    emit(symbol == '?' ? 0 : 1, symbol);
+  }
+
+  return runs;
+}
+
+
+/** Width of encoded PDF text, in 1/1000 em. */
+double pdfWidth(const std::vector<PdfRun>& runs) {
+  double w = 0;
+  for (const PdfRun& run : runs) {
+    for (char c : run.bytes) {
+      unsigned char u = c;
+      if (run.font == 0 && u >= 32 && u <= 126) {
+        w += kTimesWidths[u - 32];
+      }
+      else {
+        w += (run.font == 1) ? 600 : 500;
+      }
+    }
+  }
+  return w;
+}
+
+
+/** Append a formatted number. */
+inline void appendNum(std::string& out, double v) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.2f", v);
+  out += buf;
+}
+
+
+/** Append a color as r g b components. */
+inline void appendColor(std::string& out, const VectorCanvas::Color& c) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.3f %.3f %.3f", c.r, c.g, c.b);
+  out += buf;
+}
+
+
+/** Append a color as an SVG #rrggbb string. */
+inline void appendHexColor(std::string& out, const VectorCanvas::Color& c) {
+  char buf[8];
+  snprintf(buf, sizeof(buf), "#%02x%02x%02x",
+           int(c.r * 255 + 0.5), int(c.g * 255 + 0.5), int(c.b * 255 + 0.5));
+  out += buf;
+}
+
+
+/** Append text with XML special characters escaped. */
+void appendXml(std::string& out, const std::string& s) {
+  for (char c : s) {
+    switch (c) {
+      case '&': out += "&amp;"; break;
+      case '<': out += "&lt;"; break;
+      case '>': out += "&gt;"; break;
+      case '"': out += "&quot;"; break;
+      default: out += c;
+    }
+  }
+}
+
+
+/** Write a string to a file. */
+bool writeFile(const std::string& filename, const std::string& data) {
+  FILE* f = fopen(filename.c_str(), "wb");
+  if (!f) {
+    perror(("VectorCanvas: " + filename).c_str());
+    return false;
+  }
+  bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  ok = (fclose(f) == 0) && ok;
+  return ok;
+}
+
+}  // namespace
+
+
+void VectorCanvas::polyline(const std::vector<double>& x, const std::vector<double>& y,
+                            const Color& color, double lw) {
+  Item item;
+  item.kind = Item::kPolyline;
+  item.color = color;
+  item.size = lw;
+  item.pts.reserve(2 * x.size());
+  for (size_t i=0; i<x.size() && i<y.size(); i++) {
+    item.pts.push_back(x[i]);
+    item.pts.push_back(y[i]);
+  }
+  items.push_back(item);
+}
+
+
+void VectorCanvas::line(double x1, double y1, double x2, double y2,
+                        const Color& color, double lw) {
+  Item item;
+  item.kind = Item::kPolyline;
+  item.color = color;
+  item.size = lw;
+  item.pts = { x1, y1, x2, y2 };
+  items.push_back(item);
+}
+
+
+void VectorCanvas::rect(double x1, double y1, double x2, double y2,
+                        const Color& color, double lw, bool fill) {
+  Item item;
+  item.kind = fill ? Item::kFillRect : Item::kRect;
+  item.color = color;
+  item.size = lw;
+  item.pts = { x1, y1, x2, y2 };
+  items.push_back(item);
+}
+
+
+void VectorCanvas::circle(double x, double y, double radius, const Color& color) {
+  Item item;
+  item.kind = Item::kCircle;
+  item.color = color;
+  item.size = radius;
+  item.pts = { x, y };
+  items.push_back(item);
+}
+
+
+void VectorCanvas::text(double x, double y, const std::string& s, double size,
+                        Align align, int angle, Font font, const Color& color) {
+  Item item;
+  item.kind = Item::kText;
+  item.color = color;
+  item.size = size;
+  item.pts = { x, y };
+  item.text = s;
+  item.align = align;
+  item.angle = ((angle % 360) + 360) % 360;
+  item.font = font;
+  items.push_back(item);
+}
+
+
+bool VectorCanvas::writeSVG(const std::string& filename) const {
+  std::string out;
+  out.reserve(4096 + 128 * items.size());
+
+  out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  out += "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"";
+  appendNum(out, width);
+  out += "pt\" height=\"";
+  appendNum(out, height);
+  out += "pt\" viewBox=\"0 0 ";
+  appendNum(out, width);
+  out += " ";
+  appendNum(out, height);
+  out += "\">\n<rect width=\"100%\" height=\"100%\" fill=\"#ffffff\"/>\n";
+
+  // SVG has y increasing downward
+  for (const Item& item : items) {
+    switch (item.kind) {
+      case Item::kPolyline:
+        out += "<polyline fill=\"none\" stroke-linejoin=\"miter\" stroke=\"";
+        appendHexColor(out, item.color);
+        out += "\" stroke-width=\"";
+        appendNum(out, item.size);
+        out += "\" points=\"";
+        for (size_t i=0; i+1<item.pts.size(); i+=2) {
+          if (i > 0) out += " ";
+          appendNum(out, item.pts[i]);
+          out += ",";
+          appendNum(out, height - item.pts[i+1]);
+        }
+        out += "\"/>\n";
+        break;
+      case Item::kRect:
+      case Item::kFillRect:
+        out += "<rect x=\"";
+        appendNum(out, item.pts[0]);
+        out += "\" y=\"";
+        appendNum(out, height - item.pts[3]);
+        out += "\" width=\"";
+        appendNum(out, item.pts[2] - item.pts[0]);
+        out += "\" height=\"";
+        appendNum(out, item.pts[3] - item.pts[1]);
+        if (item.kind == Item::kFillRect) {
+          out += "\" fill=\"";
+          appendHexColor(out, item.color);
+        }
+        else {
+          out += "\" fill=\"none\" stroke=\"";
+          appendHexColor(out, item.color);
+          out += "\" stroke-width=\"";
+          appendNum(out, item.size);
+        }
+        out += "\"/>\n";
+        break;
+      case Item::kCircle:
+        out += "<circle cx=\"";
+        appendNum(out, item.pts[0]);
+        out += "\" cy=\"";
+        appendNum(out, height - item.pts[1]);
+        out += "\" r=\"";
+        appendNum(out, item.size);
+        out += "\" fill=\"";
+        appendHexColor(out, item.color);
+        out += "\"/>\n";
+        break;
+      case Item::kText: {
+        static const char* anchors[] = { "start", "middle", "end" };
+        out += "<text x=\"";
+        appendNum(out, item.pts[0]);
+        out += "\" y=\"";
+        appendNum(out, height - item.pts[1]);
+        out += "\" font-family=\"";
+        out += (item.font == kTimes ? "Times New Roman,Times,serif"
+                                    : "Helvetica,Arial,sans-serif");
+        out += "\" font-size=\"";
+        appendNum(out, item.size);
+        out += "\" text-anchor=\"";
+        out += anchors[item.align];
+        out += "\" fill=\"";
+        appendHexColor(out, item.color);
+        if (item.angle != 0) {
+          out += "\" transform=\"rotate(";
+          appendNum(out, -item.angle);
+          out += " ";
+          appendNum(out, item.pts[0]);
+          out += " ";
+          appendNum(out, height - item.pts[1]);
+          out += ")";
+        }
+        out += "\">";
+        appendXml(out, item.text);
+        out += "</text>\n";
+        break;
+      }
+    }
+  }
+
+  out += "</svg>\n";
+
+  return writeFile(filename, out);
+}
+
+
+bool VectorCanvas::writePDF(const std::string& filename) const {
+  // Page content stream
+  std::string cs;
+  cs.reserve(4096 + 128 * items.size());
+  cs += "1 J 0 j\n";
+
+  for (const Item& item : items) {
+    switch (item.kind) {
+      case Item::kPolyline:
+        appendColor(cs, item.color);
+        cs += " RG ";
+        appendNum(cs, item.size);
+        cs += " w\n";
+        for (size_t i=0; i+1<item.pts.size(); i+=2) {
+          appendNum(cs, item.pts[i]);
+          cs += " ";
+          appendNum(cs, item.pts[i+1]);
+          cs += (i == 0 ? " m\n" : " l\n");
+        }
+        cs += "S\n";
+        break;
+      case Item::kRect:
+      case Item::kFillRect:
+        appendColor(cs, item.color);
+        cs += (item.kind == Item::kFillRect ? " rg\n" : " RG ");
+        if (item.kind == Item::kRect) {
+          appendNum(cs, item.size);
+          cs += " w\n";
+        }
+        appendNum(cs, item.pts[0]);
+        cs += " ";
+        appendNum(cs, item.pts[1]);
+        cs += " ";
+        appendNum(cs, item.pts[2] - item.pts[0]);
+        cs += " ";
+        appendNum(cs, item.pts[3] - item.pts[1]);
+        cs += (item.kind == Item::kFillRect ? " re f\n" : " re S\n");
+        break;
+      case Item::kCircle: {
+        // Four Bezier arcs
+        const double k = 0.5523 * item.size;
+        double x = item.pts[0];
+        double y = item.pts[1];
+        double r = item.size;
+        char buf[512];
+        appendColor(cs, item.color);
+        snprintf(buf, sizeof(buf),
+                 " rg\n%.2f %.2f m\n"
+                 "%.2f %.2f %.2f %.2f %.2f %.2f c\n"
+                 "%.2f %.2f %.2f %.2f %.2f %.2f c\n"
+                 "%.2f %.2f %.2f %.2f %.2f %.2f c\n"
+                 "%.2f %.2f %.2f %.2f %.2f %.2f c\nf\n",
+                 x + r, y,
+                 x + r, y + k, x + k, y + r, x, y + r,
+                 x - k, y + r, x - r, y + k, x - r, y,
+                 x - r, y - k, x - k, y - r, x, y - r,
+                 x + k, y - r, x + r, y - k, x + r, y);
+        cs += buf;
+        break;
+      }
+      case Item::kText: {
+        std::vector<PdfRun> runs = encodePdf(item.text);
+
+        // Rotation, and offset along the baseline for alignment
+        int c = 1, s = 0;
+        if (item.angle == 90) { c = 0; s = 1; }
+        else if (item.angle == 180) { c = -1; s = 0; }
+        else if (item.angle == 270) { c = 0; s = -1; }
+
+        double offset = 0;
+        if (item.align != kLeft) {
+          offset = pdfWidth(runs) * item.size / 1000;
+          if (item.align == kCenter) offset /= 2;
+        }
+        double x = item.pts[0] - c * offset;
+        double y = item.pts[1] - s * offset;
+
+        char buf[128];
+        cs += "BT\n";
+        appendColor(cs, item.color);
+        snprintf(buf, sizeof(buf), " rg\n%d %d %d %d %.2f %.2f Tm\n", c, s, -s, c, x, y);
+        cs += buf;
+        for (const PdfRun& run : runs) {
+          const char* font = (run.font == 1 ? "F3" : (item.font == kTimes ? "F1" : "F2"));
+          snprintf(buf, sizeof(buf), "/%s %.2f Tf (", font, item.size);
+          cs += buf;
+          for (char ch : run.bytes) {
+            unsigned char u = ch;
+            if (ch == '(' || ch == ')' || ch == '\\') {
+              cs += '\\';
+              cs += ch;
+            }
+            else if (u < 32 || u > 126) {
+              snprintf(buf, sizeof(buf), "\\%03o", u);
+              cs += buf;
+            }
+            else {
+              cs += ch;
+            }
+          }
+          cs += ") Tj\n";
+        }
+        cs += "ET\n";
+        break;
+      }
+    }
+  }
+
+  // Document objects
+  char buf[256];
+  std::vector<std::string> objects;
+  objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+  objects.push_back("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+  snprintf(buf, sizeof(buf),
+           "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %.2f %.2f] "
+           "/Resources << /Font << /F1 5 0 R /F2 6 0 R /F3 7 0 R >> >> "
+           "/Contents 4 0 R >>", width, height);
+  objects.push_back(buf);
+  snprintf(buf, sizeof(buf), "<< /Length %lu >>\nstream\n", (unsigned long) cs.size());
+  objects.push_back(buf + cs + "endstream");
+  objects.push_back("<< /Type /Font /Subtype /Type1 /BaseFont /Times-Roman "
+                    "/Encoding /WinAnsiEncoding >>");
+  objects.push_back("<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica "
+                    "/Encoding /WinAnsiEncoding >>");
+  objects.push_back("<< /Type /Font /Subtype /Type1 /BaseFont /Symbol >>");
+
+  std::string out = "%PDF-1.4\n";
+  std::vector<size_t> offsets;
+  for (size_t i=0; i<objects.size(); i++) {
+    offsets.push_back(out.size());
+    snprintf(buf, sizeof(buf), "%lu 0 obj\n", (unsigned long) i + 1);
+    out += buf;
+    out += objects[i];
+    out += "\nendobj\n";
+  }
+
+  size_t xref = out.size();
+  snprintf(buf, sizeof(buf), "xref\n0 %lu\n0000000000 65535 f \n",
+           (unsigned long) objects.size() + 1);
+  out += buf;
+  for (size_t offset : offsets) {
+    snprintf(buf, sizeof(buf), "%010lu 00000 n \n", (unsigned long) offset);
+    out += buf;
+  }
+  snprintf(buf, sizeof(buf), "trailer\n<< /Size %lu /Root 1 0 R >>\nstartxref\n%lu\n%%%%EOF\n",
+           (unsigned long) objects.size() + 1, (unsigned long) xref);
+  out += buf;
+
+  return writeFile(filename, out);
+}
+
+
+double VectorCanvas::textWidth(const std::string& s, double size) {
+  return pdfWidth(encodePdf(s)) * size / 1000;
+}
+
+
+std::string VectorCanvas::convertLatex(const std::string& s) {
+  std::string out;
+  size_t i = 0;
+  while (i < s.size()) {
+    char c = s[i];
+
+    if (c == '#') {
+      // Command name
+      size_t start = ++i;
+      while (i < s.size() && isalpha((unsigned char) s[i])) i++;
+      std::string name = s.substr(start, i - start);
+
+      bool found = false;
+      for (const LatexSymbol& ls : kLatexSymbols) {
+        if (name == ls.name) {
+          appendUtf8(out, ls.cp);
+          found = true;
+          break;
+        }
+      }
+      if (found) continue;
+
+      if (name == "font" || name == "color") {
+        // #font[n]{...}, #color[n]{...}: drop the setting
+        if (i < s.size() && s[i] == '[') {
+          size_t end = s.find(']', i);
+          i = (end == std::string::npos) ? s.size() : end + 1;
+        }
+      }
+      else if (name == "splitline") {
+        out += convertLatex(readArgument(s, i));
+        out += " ";
+      }
+      else if (name == "frac") {
+        out += convertLatex(readArgument(s, i));
+        out += "/";
+      }
+      else if (name != "it" && name != "bf" && name != "rm" && name != "mathrm" &&
+               name != "bar" && name != "hat" && name != "tilde" && name != "vec" &&
+               name != "kern" && name != "lower") {
+        out += name;
+      }
+      continue;
+    }
+
+    if (c == '^' || c == '_') {
+      i++;
+      std::string arg = convertLatex(readArgument(s, i));
+      const uint32_t* table = (c == '^') ? kSuperscripts : kSubscripts;
+      bool scriptable = !arg.empty();
+      for (char a : arg) {
+        if (!strchr(kScriptChars, a) || a == 0) scriptable = false;
+      }
+
+      if (scriptable) {
+        for (char a : arg) {
+          appendUtf8(out, table[strchr(kScriptChars, a) - kScriptChars]);
+        }
+      }
+      else {
+        out += c;
+        out += arg;
+      }
+      continue;
+    }
+
+    if (c == '{' || c == '}') {
+      i++;
+      continue;
+    }
+
+    out += c;
+    i++;
+  }
+
+  return out;
+}
+
@@ -0,0 +1,167 @@
+#ifndef __plotter_VectorCanvas__
+#define __plotter_VectorCanvas__
+
+#include <string>
+#include <vector>
+
+/**
+ * @class VectorCanvas
+ * @brief Minimal vector drawing surface written directly as SVG or PDF
+ *
+ * Primitives (lines, rectangles, circles and text) are recorded in a display
+ * list and serialized on request, without going through ROOT graphics.
+ * Coordinates are in points, with the origin at the lower left as in PDF.
+ *
+ * Text is plain: TLatex markup must be converted first, e.g. with
+ * convertLatex.
+ */
+class VectorCanvas {
+public:
+  /** An RGB color, components in [0, 1]. */
+  struct Color {
+    Color(double _r=0, double _g=0, double _b=0) : r(_r), g(_g), b(_b) {}
+    double r;  //!< Red
+    double g;  //!< Green
+    double b;  //!< Blue
+  };
+
+  /** Horizontal text alignment. */
+  enum Align { kLeft, kCenter, kRight };
+
+  /** Text fonts. */
+  enum Font { kTimes, kHelvetica };
+
+  /**
+   * Constructor.
+   *
+   * @param _width Width in points
+   * @param _height Height in points
+   */
+  VectorCanvas(double _width, double _height) : width(_width), height(_height) {}
+
+  /**
+   * Draw a line through a series of points.
+   *
+   * @param x Point x coordinates
+   * @param y Point y coordinates
+   * @param color Line color
+   * @param lw Line width
+   */
+  void polyline(const std::vector<double>& x, const std::vector<double>& y,
+                const Color& color, double lw=1);
+
+  /**
+   * Draw a straight line.
+   *
+   * @param x1 Start x
+   * @param y1 Start y
+   * @param x2 End x
+   * @param y2 End y
+   * @param color Line color
+   * @param lw Line width
+   */
+  void line(double x1, double y1, double x2, double y2, const Color& color,
+            double lw=1);
+
+  /**
+   * Draw a rectangle.
+   *
+   * @param x1 Lower x
+   * @param y1 Lower y
+   * @param x2 Upper x
+   * @param y2 Upper y
+   * @param color Line or fill color
+   * @param lw Line width, ignored if filled
+   * @param fill Fill the rectangle rather than outlining it
+   */
+  void rect(double x1, double y1, double x2, double y2, const Color& color,
+            double lw=1, bool fill=false);
+
+  /**
+   * Draw a filled circle.
+   *
+   * @param x Center x
+   * @param y Center y
+   * @param radius Radius
+   * @param color Fill color
+   */
+  void circle(double x, double y, double radius, const Color& color);
+
+  /**
+   * Draw a line of text.
+   *
+   * Only left-aligned text may use non-Times fonts; alignment of other text
+   * needs the character widths, which are only tabulated for Times.
+   *
+   * @param x Anchor x
+   * @param y Baseline y
+   * @param s Text, UTF-8
+   * @param size Font size in points
+   * @param align Alignment relative to the anchor
+   * @param angle Counterclockwise rotation in degrees, multiple of 90
+   * @param font Font
+   * @param color Text color
+   */
+  void text(double x, double y, const std::string& s, double size,
+            Align align=kLeft, int angle=0, Font font=kTimes,
+            const Color& color=Color());
+
+  /**
+   * Write the drawing as SVG.
+   *
+   * @param filename Output filename
+   * @returns True on success
+   */
+  bool writeSVG(const std::string& filename) const;
+
+  /**
+   * Write the drawing as a single-page PDF.
+   *
+   * @param filename Output filename
+   * @returns True on success
+   */
+  bool writePDF(const std::string& filename) const;
+
+  /**
+   * Width of a string in Times-Roman.
+   *
+   * @param s Text, UTF-8
+   * @param size Font size in points
+   */
+  static double textWidth(const std::string& s, double size);
+
+  /**
+   * Convert TLatex markup to plain UTF-8 text.
+   *
+   * Greek letters and common symbols become their Unicode characters, and
+   * numeric super- and subscripts use Unicode digits. Anything else is
+   * reduced to its text.
+   *
+   * @param s TLatex string
+   * @returns Plain text
+   */
+  static std::string convertLatex(const std::string& s);
+
+public:
+  double width;  //!< Width in points
+  double height;  //!< Height in points
+
+private:
+  /** A recorded primitive. */
+  struct Item {
+    enum Kind { kPolyline, kRect, kFillRect, kCircle, kText };
+    Kind kind;  //!< Type of primitive
+    std::vector<double> pts;  //!< Coordinates (x0, y0, x1, y1, ...)
+    Color color;  //!< Stroke, fill or text color
+    double size;  //!< Line width, radius or font size
+    std::string text;  //!< Text, for kText
+    Align align;  //!< Text alignment
+    int angle;  //!< Text rotation
+    Font font;  //!< Text font
+  };
+
+  std::vector<Item> items;  //!< Display list, in drawing order
+};
+
+#endif  // __plotter_VectorCanvas__
+
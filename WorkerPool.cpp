@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "WorkerPool.h"
+
+namespace {
+
+/** Status record sent from a worker to the parent after each task. */
+struct TaskResult {
+  uint32_t index;  //!< Task index
+  uint32_t ok;  //!< Nonzero on success
+};
+
+}  // namespace
+
+
+std::vector<bool> WorkerPool::run(size_t ntasks, Task task, Hook init,
+                                  Hook finish, BatchHook start) {
+  std::vector<bool> results(ntasks, false);
+
+  std::vector<size_t> tasks(ntasks);
+  for (size_t i=0; i<ntasks; i++) tasks[i] = i;
+
+  // Every round drops the task each dead worker was running, so this ends
+  while (!tasks.empty()) {
+    std::vector<size_t> retry;
+    runRound(tasks, task, init, finish, start, results, retry);
+    if (!retry.empty()) {
+      std::cerr << "WorkerPool: running " << retry.size()
+                << " unfinished tasks again" << std::endl;
+    }
+    tasks.swap(retry);
+  }
+
+  return results;
+}
+
+
+void WorkerPool::runRound(const std::vector<size_t>& tasks, Task& task, Hook& init,
+                          Hook& finish, BatchHook& start, std::vector<bool>& results,
+                          std::vector<size_t>& retry) {
+  size_t bsize = std::max<size_t>(batch, 1);
+  size_t nbatches = (tasks.size() + bsize - 1) / bsize;
+  auto get_batch = [&](size_t b) {
+    size_t first = b * bsize;
+    size_t last = std::min(first + bsize, tasks.size());
+    return std::vector<size_t>(tasks.begin() + first, tasks.begin() + last);
+  };
+
+  // Run in-process if there is nothing to parallelize
+  if (njobs <= 1) {
+    if (init) init();
+    for (size_t b=0; b<nbatches; b++) {
+      std::vector<size_t> ids = get_batch(b);
+      if (start) start(ids);
+      for (size_t i : ids) {
+        results[i] = task(i);
+      }
+    }
+    if (finish) finish();
+    return;
+  }
+
+  // Workers claim batches by incrementing a counter in shared memory
+  void* mem = mmap(nullptr, sizeof(std::atomic<size_t>), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    perror("WorkerPool: mmap");
+    return;
+  }
+  std::atomic<size_t>* next = new (mem) std::atomic<size_t>(0);
+
+  // Results come back over a single pipe; records are smaller than
+  // PIPE_BUF, so writes from different workers do not interleave
+  int fd[2];
+  if (pipe(fd) != 0) {
+    perror("WorkerPool: pipe");
+    munmap(mem, sizeof(std::atomic<size_t>));
+    return;
+  }
+
+  // Avoid duplicating buffered output in the children
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(nullptr);
+
+  size_t nworkers = std::min<size_t>(njobs, nbatches);
+  std::vector<pid_t> pids;
+  for (size_t w=0; w<nworkers; w++) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("WorkerPool: fork");
+      continue;
+    }
+
+    if (pid == 0) {
+      // Worker: claim and run batches until there are none left
+      close(fd[0]);
+      if (init) init();
+      for (size_t b=next->fetch_add(1); b<nbatches; b=next->fetch_add(1)) {
+        std::vector<size_t> ids = get_batch(b);
+        if (start) start(ids);
+        for (size_t i : ids) {
+          TaskResult r;
+          r.index = i;
+          r.ok = task(i) ? 1 : 0;
+          ssize_t n;
+          do {
+            n = write(fd[1], &r, sizeof(r));
+          } while (n < 0 && errno == EINTR);
+        }
+      }
+      if (finish) finish();
+      std::cout.flush();
+      std::cerr.flush();
+      fflush(nullptr);
+      close(fd[1]);
+      _exit(0);
+    }
+
+    pids.push_back(pid);
+  }
+
+  // Parent: collect results until all workers have closed the pipe
+  close(fd[1]);
+  std::vector<bool> reported(results.size(), false);
+  TaskResult r;
+  for (;;) {
+    ssize_t n = read(fd[0], &r, sizeof(r));
+    if (n < 0 && errno == EINTR) continue;
+    if (n != sizeof(r)) break;
+    if (r.index < results.size()) {
+      results[r.index] = (r.ok != 0);
+      reported[r.index] = true;
+    }
+  }
+  close(fd[0]);
+
+  for (pid_t pid : pids) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cerr << "WorkerPool: worker " << pid << " exited abnormally"
+                << std::endl;
+    }
+  }
+
+  size_t nclaimed = std::min(next->load(), nbatches);
+  munmap(mem, sizeof(std::atomic<size_t>));
+
+  // Batches run in order, so a dead worker was running the first unreported
+  // task of its batch; that one stays failed and the rest are run again.
+  // Batches never claimed (every worker died first) stay failed too.
+  for (size_t b=0; b<nclaimed; b++) {
+    bool found = false;
+    for (size_t i : get_batch(b)) {
+      if (reported[i]) continue;
+      if (found) {
+        retry.push_back(i);
+      }
+      found = true;
+    }
+  }
+}
+
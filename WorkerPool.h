@@ -0,0 +1,70 @@
+#ifndef __plotter_WorkerPool__
+#define __plotter_WorkerPool__
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/**
+ * @class WorkerPool
+ * @brief Run a list of tasks across a pool of forked worker processes
+ *
+ * ROOT graphics are not thread safe, so parallelism is done with processes.
+ * Workers claim batches of consecutive tasks from a counter shared with the
+ * parent as they go, so the load is balanced, and results are returned in
+ * task order regardless of the order in which workers finish. If a worker
+ * dies, only the task it was running fails: the rest of its batch is run
+ * again by new workers.
+ */
+class WorkerPool {
+public:
+  /** A task, called with its index. Returns true on success. */
+  typedef std::function<bool(size_t)> Task;
+
+  /** Per-worker hook. */
+  typedef std::function<void()> Hook;
+
+  /** Per-batch hook, called with the indices of a batch before it is run. */
+  typedef std::function<void(const std::vector<size_t>&)> BatchHook;
+
+  /**
+   * Constructor.
+   *
+   * @param _njobs Number of worker processes (1 runs in-process)
+   * @param _batch Number of tasks a worker claims at a time
+   */
+  WorkerPool(unsigned _njobs, size_t _batch=1) : njobs(_njobs), batch(_batch) {}
+
+  /**
+   * Run all tasks.
+   *
+   * @param ntasks Number of tasks
+   * @param task Task function
+   * @param init Per-worker setup, called before any tasks
+   * @param finish Per-worker teardown, called after all tasks
+   * @param start Per-batch setup, called before the tasks in a batch
+   * @returns Success flag for each task, in task order
+   */
+  std::vector<bool> run(size_t ntasks, Task task, Hook init=nullptr,
+                        Hook finish=nullptr, BatchHook start=nullptr);
+
+private:
+  /**
+   * Run a set of tasks once.
+   *
+   * @param tasks Task indices, split into batches in this order
+   * @param results Success flags by task index, set for each task run
+   * @param retry Filled with the tasks to run again: those left in a batch
+   *              after the task its worker died on
+   */
+  void runRound(const std::vector<size_t>& tasks, Task& task, Hook& init,
+                Hook& finish, BatchHook& start, std::vector<bool>& results,
+                std::vector<size_t>& retry);
+
+public:
+  unsigned njobs;  //!< Number of worker processes
+  size_t batch;  //!< Tasks claimed by a worker at a time
+};
+
+#endif  // __plotter_WorkerPool__
+
@@ -0,0 +1,43 @@
+/**
+ * Convert a nuiscomp ROOT file into a histogram bundle.
+ *
+ * Usage: bundler input.root output.hbundle
+ */
+
+#include <iostream>
+#include <string>
+#include "TFile.h"
+#include "HistBundle.h"
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " input.root output.hbundle" << std::endl;
+    return 1;
+  }
+
+  std::string output = argv[2];
+  if (!HistBundle::isBundle(output)) {
+    std::cerr << "Output file name must end in .hbundle" << std::endl;
+    return 1;
+  }
+
+  TFile* tfile = TFile::Open(argv[1]);
+  if (!tfile || !tfile->IsOpen()) {
+    std::cerr << "Unable to open " << argv[1] << std::endl;
+    return 1;
+  }
+
+  int n = HistBundle::write(tfile, output);
+  tfile->Close();
+  delete tfile;
+
+  if (n < 0) {
+    std::cerr << "Error writing " << output << std::endl;
+    return 1;
+  }
+
+  std::cout << output << ": Wrote " << n << " histograms." << std::endl;
+
+  return 0;
+}
+
@@ -17,34 +17,160 @@
 
 #include "json.hh"
 
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
 #include <limits>
 #include <climits>
+#include <cmath>
 #include <cerrno>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace json {
 
+    Arena *Arena::current = NULL;
+
+    Arena::Arena(size_t block_size_) : next(NULL), end(NULL), block_size(block_size_), bytes(0), finalizers(NULL) {
+        //Never reaches zero, so Values in the arena are never cleaned up individually
+        pinned = std::numeric_limits<TUInteger>::max() / 2;
+    }
+
+    Arena::~Arena() {
+        for (Finalizer *f = finalizers; f; f = f->next) {
+            f->destroy(f->object);
+        }
+        for (size_t i = 0; i < blocks.size(); i++) {
+            delete [] blocks[i];
+        }
+    }
+
+    void *Arena::allocate(size_t size, size_t align) {
+        char *p = (char*)(((size_t)next + align - 1) & ~(align - 1));
+        if (!next || p + size > end) {
+            const size_t length = std::max(block_size, size + align);
+            blocks.push_back(new char[length]);
+            next = blocks.back();
+            end = next + length;
+            p = (char*)(((size_t)next + align - 1) & ~(align - 1));
+        }
+        next = p + size;
+        bytes += size;
+        return p;
+    }
+
+    template <typename T> T *Arena::create() {
+        T *object = new (allocate(sizeof(T), alignof(T))) T();
+        Finalizer *f = static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+        f->next = finalizers;
+        f->object = object;
+        f->destroy = &destroy<T>;
+        finalizers = f;
+        return object;
+    }
+
+    namespace {
+        //A key given as characters and length
+        struct Key {
+            const char *data;
+            size_t length;
+        };
+
+        //Orders members by key alone
+        struct KeyLess {
+            inline bool operator()(const Object::Member &a, const Object::Member &b) const { return a.first < b.first; }
+            inline bool operator()(const Object::Member &a, const Key &b) const { return a.first.compare(0, TString::npos, b.data, b.length) < 0; }
+        };
+
+        inline bool keyEquals(const TString &a, const char *key, size_t length) {
+            return a.size() == length && !memcmp(a.data(), key, length);
+        }
+    }
+
+    Object::iterator Object::lowerBound(const char *key, size_t length) {
+        Key k = { key, length };
+        return std::lower_bound(members.begin(), members.end(), k, KeyLess());
+    }
+
+    Object::const_iterator Object::lowerBound(const char *key, size_t length) const {
+        Key k = { key, length };
+        return std::lower_bound(members.begin(), members.end(), k, KeyLess());
+    }
+
+    Object::iterator Object::find(const char *key, size_t length) {
+        iterator it = lowerBound(key, length);
+        return (it != members.end() && keyEquals(it->first, key, length)) ? it : members.end();
+    }
+
+    Object::const_iterator Object::find(const char *key, size_t length) const {
+        const_iterator it = lowerBound(key, length);
+        return (it != members.end() && keyEquals(it->first, key, length)) ? it : members.end();
+    }
+
+    Value &Object::operator[](const TString &key) {
+        iterator it = lowerBound(key.data(), key.size());
+        if (it == members.end() || it->first != key) {
+            it = members.insert(it, Member());
+            it->first = key;
+        }
+        return it->second;
+    }
+
+    void Object::append(const char *key, size_t length, const Value &value) {
+        members.push_back(Member());
+        members.back().first.assign(key, length);
+        members.back().second = value;
+    }
+
+    void Object::sort() {
+        //Parsed objects are small and often already in order, where insertion sort is linear
+        if (members.size() <= 16) {
+            for (size_t i = 1; i < members.size(); i++) {
+                for (size_t j = i; j > 0 && members[j].first < members[j-1].first; j--) {
+                    std::swap(members[j], members[j-1]);
+                }
+            }
+        } else {
+            std::stable_sort(members.begin(), members.end(), KeyLess());
+        }
+
+        //Equal keys are adjacent in the order they were appended
+        size_t kept = 0;
+        for (size_t i = 0; i < members.size(); i++) {
+            if (kept && members[kept-1].first == members[i].first) {
+                members[kept-1].second = members[i].second;
+            } else {
+                if (kept != i) std::swap(members[kept], members[i]);
+                kept++;
+            }
+        }
+        members.erase(members.begin() + kept, members.end());
+    }
+
     void Value::reset(Type type_) {
         decref();
         this->type = type_;
+        Arena *arena = Arena::current;
         switch (type) {
             case TSTRING:
-                data.string = new TString();
-                refcount = new TUInteger(0);
-                return;
+                data.string = arena ? arena->create<TString>() : new TString();
+                break;
             case TOBJECT:
-                data.object = new TObject();
-                refcount = new TUInteger(0);
-                return;
+                data.object = arena ? arena->create<TObject>() : new TObject();
+                break;
             case TARRAY:
-                data.array = new TArray();
-                refcount = new TUInteger(0);
-                return;
+                data.array = arena ? arena->create<TArray>() : new TArray();
+                break;
             default:
                 refcount = NULL;
+                return;
         }
+        refcount = arena ? &arena->pinned : new TUInteger(0);
     }
 
     void Value::clean() {
@@ -76,9 +202,8 @@ namespace json {
         return keys;
     }
 
-    bool Value::isMember(std::string key) const {
-        checkType(TOBJECT);
-        return (data.object->find(key) != data.object->end());
+    bool Value::isMember(const std::string &key) const {
+        return findMember(key) != NULL;
     }
 
     std::string Value::toJSONString() {
@@ -141,6 +266,8 @@ namespace json {
         data[ret.length()] = '\0';
         line = 1;
         lastbr = cur;
+        mapped = 0;
+        arena = NULL;
     }
 
     Reader::Reader(const std::string &str) {
@@ -150,13 +277,82 @@ namespace json {
         data[str.length()] = '\0';
         line = 1;
         lastbr = cur;
+        mapped = 0;
+        arena = NULL;
+    }
+
+    Reader::Reader(const MapFile &file) {
+        line = 1;
+        mapped = 0;
+        arena = NULL;
+        int fd = open(file.path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd,&st) != 0) {
+            if (fd >= 0) close(fd);
+            throw parser_error(0,0,"Cannot open " + file.path + ": " + strerror(errno));
+        }
+        const size_t size = st.st_size;
+        if (size == 0) {
+            close(fd);
+            data = new char[1];
+            data[0] = '\0';
+            cur = lastbr = data;
+            return;
+        }
+
+        //The parser writes into the buffer only to unescape strings and rewrite non-json number suffixes, so
+        //the mapping is private: just the pages it touches are copied. It also needs a '\0' after the last byte. Within the file's last
+        //page that is guaranteed, but if the file ends on a page boundary the terminator goes on an anonymous
+        //(zero) page mapped right after it.
+        const size_t page = sysconf(_SC_PAGESIZE);
+        const size_t length = size + 1;
+        void *base;
+        if (size % page == 0) {
+            base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base != MAP_FAILED && mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+                munmap(base, length);
+                base = MAP_FAILED;
+            }
+        } else {
+            base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        }
+        const int err = errno;
+        close(fd);
+        if (base == MAP_FAILED) {
+            throw parser_error(0,0,"Cannot map " + file.path + ": " + strerror(err));
+        }
+        madvise(base, length, MADV_SEQUENTIAL);
+
+        data = cur = lastbr = static_cast<char*>(base);
+        mapped = length;
     }
 
     Reader::~Reader() {
-        delete [] data;
+        if (mapped) {
+            munmap(data, mapped);
+        } else {
+            delete [] data;
+        }
     }
 
+    //Makes an arena current for the lifetime of the guard
+    class ArenaGuard {
+        public:
+            ArenaGuard(Arena *arena) : previous(Arena::current) { if (arena) Arena::current = arena; }
+            ~ArenaGuard() { Arena::current = previous; }
+        private:
+            Arena *previous;
+    };
+
     bool Reader::getValue(Value &result) {
+        if (!parse(builder)) return false;
+        result = builder.getResult();
+        builder.getResult().reset();
+        return true;
+    }
+
+    bool Reader::parse(Handler &handler) {
+        ArenaGuard guard(arena);
         for (;;) {
             switch (*cur) {
                 case '\n':
@@ -180,35 +376,35 @@ namespace json {
                 case '7':
                 case '8':
                 case '9':
-                    result = readNumber();
+                    handler.scalar(readNumber());
                     return true;
                 case '{':
-                    result = readObject();
+                    readObject(handler);
                     return true;
                 case '[':
-                    result = readArray();
+                    readArray(handler);
                     return true;
                 case '"':
-                    result = readString();
+                    readString(handler);
                     return true;
                 case 'n': //https://tools.ietf.org/rfc/rfc7159.txt
                     if (cur[1] == 'u' && cur[2] == 'l' && cur[3] == 'l') {
                         cur+=4;
-                        result = Value();
+                        handler.scalar(Value());
                         return true;
                     }
                     throw parser_error(line,cur-lastbr,"Unexpected character");
                 case 't': //https://tools.ietf.org/rfc/rfc7159.txt
                     if (cur[1] == 'r' && cur[2] == 'u' && cur[3] == 'e') {
                         cur+=4;
-                        result = Value(true);
+                        handler.scalar(Value(true));
                         return true;
                     }
                     throw parser_error(line,cur-lastbr,"Unexpected character");
                 case 'f': //https://tools.ietf.org/rfc/rfc7159.txt
                     if (cur[1] == 'a' && cur[2] == 'l' && cur[3] == 's' && cur[4] == 'e') {
                         cur+=5;
-                        result = Value(false);
+                        handler.scalar(Value(false));
                         return true;
                     }
                     throw parser_error(line,cur-lastbr,"Unexpected character");
@@ -289,15 +485,13 @@ namespace json {
                                     cur++;
                                     break;
                                 default: {
-                                    char next = *cur;
-                                    *cur = '\0';
+                                    //strtoul stops at the first non-hex character, so the buffer is not touched
                                     errno = 0;
                                     char *end;
                                     TUInteger ui = strtoul(start,&end,16);
                                     if (end != cur) throw parser_error(line,cur-lastbr,"Malformed hex number");
                                     if (ui == ULONG_MAX && errno == ERANGE)
                                         throw parser_error(line,cur-lastbr,"Unsigned integer out of bounds.");
-                                    *cur = next;
                                     return Value(ui);
                                 }
                             }
@@ -367,8 +561,8 @@ namespace json {
                     cur++;
                     break;
                 default: { //any other character is end of number
-                    char next = *cur;
-                    *cur = '\0';
+                    //strtod and strtol stop at that character too, so there is no need to terminate the number
+                    //(writing to the buffer would dirty every page of a file mapping)
                     Value val;
                     if (real || exp) {
                         char *end;
@@ -391,7 +585,6 @@ namespace json {
                             val = Value(i);
                         }
                     }
-                    *cur = next;
                     return val;
                 }
             }
@@ -399,29 +592,80 @@ namespace json {
         throw parser_error(line,cur-lastbr,"Should never reach here. Probably hardware error.");
     }
 
-    Value Reader::readString() {
+    void Reader::readString(Handler &handler) {
         char *start = ++cur;
+        char *end = scanString();
+        handler.string(start, end-start);
+    }
+
+    //https://tools.ietf.org/rfc/rfc7159.txt
+    char *Reader::scanString(bool unescape) {
+        //Most strings have no escapes: find the end without copying
+        while (*cur != '"' && *cur != '\\' && *cur) cur++;
+
+        if (!unescape) {
+            for (;;) {
+                switch (*(cur++)) {
+                    case '\\':
+                        if (!*(cur++)) throw parser_error(line,cur-lastbr,"Reached EOF while parsing string");
+                        break;
+                    case '"':
+                        return cur-1;
+                    case '\0':
+                        throw parser_error(line,cur-lastbr,"Reached EOF while parsing string");
+                }
+            }
+        }
+
+        //Past the first escape, the unescaped text is written back over the escaped text it came from,
+        //which it can never overtake
+        char *out = cur;
         for (;;) {
-            switch (*(cur++)) {
-                case '\\':
-                    cur++; //definitely an escape, so skip next character
-                    break;
-                case '\"':
-                    cur[-1] = '\0';
-                    return Value(unescapeString(std::string(start)));
+            switch (*cur) {
+                case '"':
+                    cur++;
+                    return out;
                 case '\0':
                     throw parser_error(line,cur-lastbr,"Reached EOF while parsing string");
+                case '\\':
+                    switch (cur[1]) {
+                        case '"':
+                        case '\\':
+                        case '/':
+                            *(out++) = cur[1];
+                            break;
+                        case 'b':
+                            *(out++) = '\b';
+                            break;
+                        case 'f':
+                            *(out++) = '\f';
+                            break;
+                        case 'n':
+                            *(out++) = '\n';
+                            break;
+                        case 'r':
+                            *(out++) = '\r';
+                            break;
+                        case 't':
+                            *(out++) = '\t';
+                            break;
+                        case 'u':
+                            throw parser_error(line,cur-lastbr,"Arbitrary unicode escapes not yet supported"); //FIXME
+                        default:
+                            throw parser_error(line,cur-lastbr,"Invalid escape sequence in string");
+                    }
+                    cur += 2;
+                    break;
+                default:
+                    *(out++) = *(cur++);
             }
         }
-        throw parser_error(line,cur-lastbr,"Should never reach here. Probably hardware error.");
     }
 
-    Value Reader::readObject() {
-        Value object = Value();
-        object.reset(TOBJECT);
-        char *key = NULL;
+    void Reader::readObject(Handler &handler) {
+        char *key = NULL, *keyend = NULL;
         bool keyfound = false;
-        Value val = Value();
+        handler.startObject();
         cur++;
         for (;;) {
             switch (*cur) {
@@ -435,7 +679,7 @@ namespace json {
                 case ' ':
                 case '\t':
                     if (key && !keyfound) {
-                        *cur = '\0';
+                        keyend = cur;
                         keyfound = true;
                     }
                     cur++;
@@ -445,7 +689,8 @@ namespace json {
                     if (key) {
                         throw parser_error(line,cur-lastbr,"} found where value expected");
                     }
-                    return object;
+                    handler.endObject();
+                    return;
                 case ',':
                     cur++;
                     if (key) {
@@ -456,19 +701,19 @@ namespace json {
                     if (!key) {
                         throw parser_error(line,cur-lastbr,": found where field expected");
                     }
-                    if (key && !keyfound) *cur = '\0';
+                    if (key && !keyfound) keyend = cur;
                     cur++;
-                    if (!getValue(val)) {
+                    handler.key(key,keyend-key);
+                    if (!parse(handler)) {
                         throw parser_error(line,cur-lastbr,"EOF reached while parsing object");
                     }
-                    object.setMember(std::string(key),val);
                     key = NULL;
                     keyfound = false;
                     break;
                 case '\"':
                     cur++;
                     key = cur;
-                    readString();
+                    keyend = scanString(false);
                     keyfound = true;
                     break;
                 case '\0':
@@ -484,10 +729,9 @@ namespace json {
         throw parser_error(line,cur-lastbr,"Should never reach here. Probably hardware error.");
     }
 
-    Value Reader::readArray() {
-        Value array = Value();
-        array.reset(TARRAY);
-        Value next = Value();
+    void Reader::readArray(Handler &handler) {
+        bool empty = true;
+        handler.startArray();
         cur++;
         for (;;) {
             switch (*cur) {
@@ -505,191 +749,402 @@ namespace json {
                     break;
                 case ':':  { //non-json value repetition
                     cur++;
-                    Value reps;
-                    if (!getValue(reps) || reps.getType() != TINTEGER || reps.getInteger() < 0) {
+                    //not getValue: its builder may be the one receiving this array
+                    Builder count;
+                    if (empty || !parse(count)) {
                         throw parser_error(line,cur-lastbr,"Array value repetition syntax error");
                     }
-                    const int nreps = reps.getInteger();
-                    // The value to be repeated has already been pushed once
-                    if (nreps == 0) {
-                        array.data.array->pop_back();
-                    } else {
-                        array.data.array->reserve(array.data.array->size() + nreps - 1);
-                        for (int i = 1; i < nreps; i++) {
-                            array.data.array->push_back(next);
-                        }
+                    const Value &reps = count.getResult();
+                    if (reps.getType() != TINTEGER || reps.getInteger() < 0) {
+                        throw parser_error(line,cur-lastbr,"Array value repetition syntax error");
                     }
+                    handler.repeat(reps.getInteger());
                     break;
                 }
                 case ']':
                     cur++;
-                    return array;
+                    handler.endArray();
+                    return;
                 case '\0':
                     throw parser_error(line,cur-lastbr,"Reached EOF while parsing array");
                 default:
-                    if (!getValue(next)) {
+                    if (!parse(handler)) {
                         throw parser_error(line,cur-lastbr,"EOF reached while parsing array");
                     }
-                    array.data.array->push_back(next);
+                    empty = false;
             }
         }
         throw parser_error(line,cur-lastbr,"Should never reach here. Probably hardware error.");
     }
 
-    Writer::Writer(std::ostream &stream) : out(stream) {
+    Handler::~Handler() {
 
     }
 
-    Writer::~Writer() {
+    Builder::Builder() {
+
+    }
+
+    Builder::~Builder() {
 
     }
 
+    bool Builder::complete(Value &) {
+        return true;
+    }
+
+    void Builder::add(Value &value) {
+        const bool keep = complete(value);
+        if (stack.empty()) {
+            if (keep) result = value;
+            return;
+        }
+        Frame &top = stack.back();
+        top.kept = keep;
+        if (!keep) {
+            top.dropped = value;
+        } else if (top.container.type == TOBJECT) {
+            top.container.data.object->append(top.key,top.length,value);
+        } else {
+            top.dropped.reset();
+            top.container.data.array->push_back(value);
+        }
+        top.key = NULL;
+    }
+
+    void Builder::startObject() {
+        stack.resize(stack.size()+1);
+        stack.back().container.reset(TOBJECT);
+        stack.back().key = NULL;
+        stack.back().kept = false;
+    }
+
+    void Builder::key(const char *key, size_t length) {
+        stack.back().key = key;
+        stack.back().length = length;
+    }
+
+    void Builder::endObject() {
+        Value object = stack.back().container;
+        object.data.object->sort();
+        stack.pop_back();
+        add(object);
+    }
+
+    void Builder::startArray() {
+        stack.resize(stack.size()+1);
+        stack.back().container.reset(TARRAY);
+        stack.back().key = NULL;
+        stack.back().kept = false;
+    }
+
+    void Builder::endArray() {
+        Value array = stack.back().container;
+        stack.pop_back();
+        add(array);
+    }
+
+    void Builder::string(const char *string, size_t length) {
+        //Build the string in place: this is the only copy made of it
+        Value value(TSTRING);
+        value.data.string->assign(string,length);
+        add(value);
+    }
+
+    void Builder::scalar(const Value &value) {
+        Value copy(value);
+        add(copy);
+    }
+
+    void Builder::repeat(size_t count) {
+        //A value that complete() dropped is offered again for each extra copy
+        Frame &top = stack.back();
+        if (!top.kept) {
+            const Value last = top.dropped;
+            for (size_t i = 1; i < count; i++) {
+                Value copy(last);
+                add(copy);
+            }
+            return;
+        }
+
+        //The value to be repeated has already been added once
+        TArray &array = *top.container.data.array;
+        if (count == 0) {
+            array.pop_back();
+        } else {
+            const Value last = array.back();
+            array.reserve(array.size() + count - 1);
+            for (size_t i = 1; i < count; i++) {
+                array.push_back(last);
+            }
+        }
+    }
+
+    Writer::Writer(std::ostream &stream, bool compact_) : out(stream), compact(compact_), used(0) {
+
+    }
+
+    Writer::~Writer() {
+        flush();
+    }
+
     void Writer::putValue(const Value &value) {
-        writeValue(value,"");
-        out << '\n';
+        writeValue(value);
+        put('\n');
+        flush();
+    }
+
+    void Writer::flush() {
+        if (used) out.write(buffer,used);
+        used = 0;
     }
 
-    void Writer::writeValue(const Value &value, const std::string &depth) {
+    void Writer::put(const char *str, size_t length) {
+        if (length > BUFFER_SIZE - used) {
+            flush();
+            if (length >= BUFFER_SIZE) {
+                out.write(str,length);
+                return;
+            }
+        }
+        memcpy(buffer+used,str,length);
+        used += length;
+    }
+
+    void Writer::putIndent(int depth) {
+        static const char spaces[] = "                                                                ";
+        put('\n');
+        for (size_t n = 4*depth; n; ) {
+            const size_t chunk = std::min(n, sizeof(spaces)-1);
+            put(spaces,chunk);
+            n -= chunk;
+        }
+    }
+
+    void Writer::putUInteger(TUInteger uinteger) {
+        char digits[24];
+        char *start = digits + sizeof(digits);
+        do {
+            *(--start) = '0' + uinteger % 10;
+            uinteger /= 10;
+        } while (uinteger);
+        put(start,digits+sizeof(digits)-start);
+    }
+
+    void Writer::putInteger(TInteger integer) {
+        if (integer < 0) {
+            put('-');
+            putUInteger(0 - (TUInteger)integer);
+        } else {
+            putUInteger(integer);
+        }
+    }
+
+    namespace {
+        //Powers of ten from 1e-350 to 1e350 in extended precision
+        struct Powers {
+            enum { MIN = -350, MAX = 350 };
+            long double power[MAX-MIN+1];
+            Powers() { for (int i = MIN; i <= MAX; i++) power[i-MIN] = powl(10.0L,i); }
+            inline long double operator()(int exponent) const { return power[exponent-MIN]; }
+        };
+
+        //Formats a finite, nonzero real as printf's %.15g does: the value is scaled to 15 significant digits in
+        //extended precision and rounded. This is exact except when the digits after the 15th are within the
+        //scaling error of a half, where it gives up (returns 0) and printf has to do it.
+        int formatReal(TReal real, char *out) {
+            const int P = std::numeric_limits<double>::digits10;
+            if (std::numeric_limits<long double>::digits < 64 || !(real == real) || real == 0.0 ||
+                real - real != 0.0) {
+                return 0;
+            }
+            static const Powers powers;
+
+            char *p = out;
+            long double a = real;
+            if (a < 0) {
+                *(p++) = '-';
+                a = -a;
+            }
+
+            //Scale to [10^(P-1), 10^P), correcting the estimated exponent if needed
+            int exponent = (int)floor(log10((double)a));
+            long double scaled = a * powers(P-1-exponent);
+            if (scaled >= powers(P)) {
+                exponent++;
+                scaled = a * powers(P-1-exponent);
+            } else if (scaled < powers(P-1)) {
+                exponent--;
+                scaled = a * powers(P-1-exponent);
+            }
+
+            long double whole = floorl(scaled);
+            const long double fraction = scaled - whole;
+            if (fraction > 0.499L && fraction < 0.501L) return 0;
+            TUInteger mantissa = (TUInteger)whole + (fraction > 0.5L ? 1 : 0);
+            if (mantissa == 1000000000000000UL) {
+                mantissa = 100000000000000UL;
+                exponent++;
+            }
+
+            char digits[P];
+            for (int i = P-1; i >= 0; i--) {
+                digits[i] = '0' + mantissa % 10;
+                mantissa /= 10;
+            }
+            int ndigits = P;
+            while (ndigits > 1 && digits[ndigits-1] == '0') ndigits--;
+
+            if (exponent >= -4 && exponent < P) {
+                //Fixed notation
+                if (exponent < 0) {
+                    *(p++) = '0';
+                    *(p++) = '.';
+                    for (int i = -1; i > exponent; i--) *(p++) = '0';
+                    for (int i = 0; i < ndigits; i++) *(p++) = digits[i];
+                } else {
+                    for (int i = 0; i <= exponent; i++) *(p++) = i < ndigits ? digits[i] : '0';
+                    if (ndigits > exponent+1) {
+                        *(p++) = '.';
+                        for (int i = exponent+1; i < ndigits; i++) *(p++) = digits[i];
+                    }
+                }
+            } else {
+                //Exponential notation, with at least two exponent digits
+                *(p++) = digits[0];
+                if (ndigits > 1) {
+                    *(p++) = '.';
+                    for (int i = 1; i < ndigits; i++) *(p++) = digits[i];
+                }
+                *(p++) = 'e';
+                *(p++) = exponent < 0 ? '-' : '+';
+                if (exponent < 0) exponent = -exponent;
+                if (exponent >= 100) *(p++) = '0' + exponent / 100;
+                *(p++) = '0' + exponent / 10 % 10;
+                *(p++) = '0' + exponent % 10;
+            }
+            return p - out;
+        }
+    }
+
+    void Writer::putReal(TReal real) {
+        //Same digits as the stream with precision digits10 gives, without the locale and stream machinery
+        char digits[32];
+        int length = formatReal(real,digits);
+        if (!length) length = snprintf(digits,sizeof(digits),"%.*g",std::numeric_limits<double>::digits10,real);
+        put(digits,length);
+    }
+
+    void Writer::writeValue(const Value &value, int depth) {
         switch (value.type) {
             case TINTEGER:
-                out << value.data.integer;
+                putInteger(value.data.integer);
                 break;
             case TUINTEGER:
-                out << value.data.uinteger;
+                putUInteger(value.data.uinteger);
                 break;
             case TREAL:
-                out.precision(std::numeric_limits<double>::digits10);
-                out << value.data.real;
+                putReal(value.data.real);
                 break;
             case TSTRING:
-                out << '"' << escapeString(*(value.data.string)) << '"';
+                putString(value.data.string->data(),value.data.string->size());
                 break;
             case TOBJECT: {
-                    const std::string nextdepth(depth+"    ");
                     TObject::iterator it = value.data.object->begin();
                     TObject::iterator end = value.data.object->end();
-                    out << "{\n";
-                    if (it != end) {
-                        out << nextdepth << '\"' << it->first << "\" : ";
-                        writeValue(it->second,nextdepth);
-                        it++;
-                    }
-                    for ( ; it != end; it++) {
-                        out << ",\n" << nextdepth << '\"' << it->first << "\" : ";
-                        writeValue(it->second,nextdepth);
+                    put('{');
+                    //an empty object is still written on three lines, as it always has been
+                    if (!compact && it == end) put('\n');
+                    for (bool first = true; it != end; it++, first = false) {
+                        if (!first) put(',');
+                        //keys are written as they were read, without escaping
+                        if (!compact) putIndent(depth+1);
+                        put('"');
+                        put(it->first.data(),it->first.size());
+                        if (compact) {
+                            put("\":",2);
+                        } else {
+                            put("\" : ",4);
+                        }
+                        writeValue(it->second,depth+1);
                     }
-                    out << '\n' << depth << '}';
+                    if (!compact) putIndent(depth);
+                    put('}');
                 }
                 break;
             case TARRAY: {
+                    //elements are not indented relative to the array
                     TArray::iterator it = value.data.array->begin();
                     TArray::iterator end = value.data.array->end();
-                    out << '[';
-                    if (it != end) {
-                        writeValue(*it);
-                        it++;
-                    }
-                    for ( ; it != end; it++) {
-                        out << ", ";
+                    put('[');
+                    for (bool first = true; it != end; it++, first = false) {
+                        if (!first) {
+                            if (compact) {
+                                put(',');
+                            } else {
+                                put(", ",2);
+                            }
+                        }
                         writeValue(*it);
                     }
-                    out << ']';
+                    put(']');
                 }
                 break;
             case TNULL:
-                out << "null";
+                put("null",4);
                 break;
             case TBOOL:
-                out << (value.data.boolean ? "true" : "false");
+                if (value.data.boolean) {
+                    put("true",4);
+                } else {
+                    put("false",5);
+                }
         }
     }
 
     //https://tools.ietf.org/rfc/rfc7159.txt
-    std::string Writer::escapeString(std::string unescaped) {
-        std::stringstream escaped;
-        size_t last = 0, pos = 0, len = unescaped.length();
-        while (pos < len) {
-            switch (unescaped[pos]) {
+    void Writer::putString(const char *str, size_t length) {
+        put('"');
+        //Runs of characters that need no escape are copied as they are
+        const char *run = str;
+        for (const char *c = str, *end = str+length; c != end; c++) {
+            const char *escape;
+            switch (*c) {
                 case '"':
+                    escape = "\\\"";
+                    break;
                 case '\\':
+                    escape = "\\\\";
+                    break;
                 case '/':
-                    escaped << unescaped.substr(last,pos-last) << '\\' << unescaped[pos];
-                    last = pos+1;
+                    escape = "\\/";
                     break;
                 case '\b':
-                    escaped << unescaped.substr(last,pos-last) << "\\b";
-                    last = pos+1;
+                    escape = "\\b";
                     break;
                 case '\f':
-                    escaped << unescaped.substr(last,pos-last) << "\\f";
-                    last = pos+1;
+                    escape = "\\f";
                     break;
                 case '\n':
-                    escaped << unescaped.substr(last,pos-last) << "\\n";
-                    last = pos+1;
+                    escape = "\\n";
                     break;
                 case '\r':
-                    escaped << unescaped.substr(last,pos-last) << "\\r";
-                    last = pos+1;
+                    escape = "\\r";
                     break;
                 case '\t':
-                    escaped << unescaped.substr(last,pos-last) << "\\t";
-                    last = pos+1;
+                    escape = "\\t";
                     break;
                 default:
-                    if (unescaped[pos] < 0x20) throw parser_error(0,0,"Arbitrary unicode escapes not yet supported"); //FIXME
+                    if ((unsigned char)*c < 0x20) throw parser_error(0,0,"Arbitrary unicode escapes not yet supported"); //FIXME
+                    continue;
             }
-            pos++;
-        }
-        escaped << unescaped.substr(last,pos-last);
-        return escaped.str();
-    }
-
-    //https://tools.ietf.org/rfc/rfc7159.txt
-    std::string Reader::unescapeString(std::string escaped) {
-        if (escaped.find("\\") != std::string::npos) {
-            size_t last = 0, pos = 0;
-            std::stringstream unescaped;
-            while ((pos = escaped.find("\\",pos)) != std::string::npos) {
-                unescaped << escaped.substr(last,pos-last);
-                switch (escaped[pos+1]) {
-                    case '"':
-                    case '\\':
-                    case '/':
-                        unescaped << escaped[pos+1];
-                        last = pos = pos+2;
-                        break;
-                    case 'b':
-                        unescaped << '\b';
-                        last = pos = pos+2;
-                        break;
-                    case 'f':
-                        unescaped << '\f';
-                        last = pos = pos+2;
-                        break;
-                    case 'n':
-                        unescaped << '\n';
-                        last = pos = pos+2;
-                        break;
-                    case 'r':
-                        unescaped << '\r';
-                        last = pos = pos+2;
-                        break;
-                    case 't':
-                        unescaped << '\t';
-                        last = pos = pos+2;
-                        break;
-                    case 'u':
-                        throw parser_error(line,cur-lastbr,"Arbitrary unicode escapes not yet supported"); //FIXME
-                    default:
-                        throw parser_error(line,cur-lastbr,"Invalid escape sequence in string");
-                }
-            }
-            unescaped << escaped.substr(last);
-            return unescaped.str();
-        } else {
-            return escaped;
+            put(run,c-run);
+            put(escape,2);
+            run = c+1;
         }
+        put(run,str+length-run);
+        put('"');
     }
 
 }
@@ -19,16 +19,22 @@
 #define _JSON
 
 #include <vector>
-#include <map>
+#include <algorithm>
+#include <new>
 #include <stdexcept>
 #include <string>
 #include <sstream>
+#include <cstring>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 namespace json {
 
     class Value;
     class Reader;
     class Writer;
+    class Builder;
 
     //types used by Value
     typedef long int TInteger;
@@ -36,8 +42,128 @@ namespace json {
     typedef double TReal;
     typedef bool TBool;
     typedef std::string TString;
-    typedef std::map<TString,Value> TObject;
-    typedef std::vector<Value> TArray;
+
+    //Monotonic memory for whole parsed documents (see Reader::setArena). Memory is handed out from a few large
+    //blocks and all released at once when the arena is destroyed, along with every Value created in it. The
+    //arena must therefore outlive all Values (and copies of them) read with it.
+    class Arena {
+        friend class Value;
+
+        public:
+            //Blocks are at least block_size bytes
+            Arena(size_t block_size = 1 << 20);
+
+            //Destroys every object created in the arena and frees its blocks
+            ~Arena();
+
+            //Returns uninitialized memory, freed only with the arena
+            void *allocate(size_t size, size_t align);
+
+            //Returns the number of bytes handed out
+            inline size_t getBytes() const { return bytes; }
+
+            //Returns the number of blocks allocated
+            inline size_t getBlocks() const { return blocks.size(); }
+
+            //The arena new Values and their containers are allocated from, or NULL for the heap
+            static Arena *current;
+
+        private:
+            Arena(const Arena &);
+            Arena& operator=(const Arena &);
+
+            //Constructs an object in the arena, destroyed with it
+            template <typename T> T *create();
+
+            //Type-erased destructor call
+            template <typename T> static void destroy(void *object) { static_cast<T*>(object)->~T(); }
+
+            //Objects to destroy with the arena, as a list kept in the arena itself
+            struct Finalizer {
+                Finalizer *next;
+                void *object;
+                void (*destroy)(void *);
+            };
+
+            std::vector<char*> blocks;
+            char *next, *end;
+            size_t block_size, bytes;
+            Finalizer *finalizers;
+
+            //Shared refcount of all Values in the arena, which never drops to zero
+            TUInteger pinned;
+    };
+
+    //Allocator for the containers inside Values: takes memory from the arena current when the container is
+    //created, or the heap. Memory from an arena is not freed individually.
+    template <typename T> class ArenaAllocator {
+        public:
+            typedef T value_type;
+
+            inline ArenaAllocator() : arena(Arena::current) { }
+            template <typename U> inline ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) { }
+
+            inline T *allocate(size_t n) {
+                if (arena) return static_cast<T*>(arena->allocate(n*sizeof(T), alignof(T)));
+                return static_cast<T*>(::operator new(n*sizeof(T)));
+            }
+
+            inline void deallocate(T *p, size_t) { if (!arena) ::operator delete(p); }
+
+            //Copies of a container do not stay in the original's arena
+            inline ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+            Arena *arena;
+    };
+
+    template <typename T, typename U> inline bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena == b.arena; }
+    template <typename T, typename U> inline bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena != b.arena; }
+
+    //JSON object storage: members in a flat vector sorted by key, found by binary search. Compared to a tree
+    //this is one allocation per object and lookups walk contiguous memory. Inserting a new key moves the
+    //members after it, so references to members are invalidated when a member is added.
+    class Object {
+        public:
+            typedef std::pair<TString,Value> Member;
+            typedef std::vector<Member,ArenaAllocator<Member> > Members;
+            typedef Members::iterator iterator;
+            typedef Members::const_iterator const_iterator;
+
+            inline iterator begin() { return members.begin(); }
+            inline iterator end() { return members.end(); }
+            inline const_iterator begin() const { return members.begin(); }
+            inline const_iterator end() const { return members.end(); }
+            inline size_t size() const { return members.size(); }
+            inline bool empty() const { return members.empty(); }
+
+            //Returns the member with the key, or end()
+            inline iterator find(const TString &key) { return find(key.data(), key.size()); }
+            inline const_iterator find(const TString &key) const { return find(key.data(), key.size()); }
+
+            //As above, for a key that is not a TString (so none has to be built)
+            iterator find(const char *key, size_t length);
+            const_iterator find(const char *key, size_t length) const;
+
+            //Returns the member with the key, inserting a null one in order if it is missing
+            Value &operator[](const TString &key);
+
+            //Adds a member at the end without keeping the order (for the parser, which calls sort() once the
+            //object is complete)
+            void append(const char *key, size_t length, const Value &value);
+
+            //Restores the order after append(). Of duplicate keys the last one is kept, as with operator[].
+            void sort();
+
+        private:
+            //First member whose key is not less than key
+            iterator lowerBound(const char *key, size_t length);
+            const_iterator lowerBound(const char *key, size_t length) const;
+
+            Members members;
+    };
+
+    typedef Object TObject;
+    typedef std::vector<Value,ArenaAllocator<Value> > TArray;
 
     typedef union {
         //basic types by value
@@ -68,6 +194,7 @@ namespace json {
 
         friend class Reader;
         friend class Writer;
+        friend class Builder;
 
         public:
 
@@ -128,10 +255,13 @@ namespace json {
             inline TUInteger getUInteger() const { checkType(TUINTEGER); return data.uinteger; }
             inline TReal getReal() const { checkType(TREAL); return data.real; }
             inline TBool getBool() const { checkType(TBOOL); return data.boolean; }
-            inline TString getString() const { checkType(TSTRING); return *data.string; }
+            inline const TString &getString() const { checkType(TSTRING); return *data.string; }
+#if __cplusplus >= 201703L
+            inline std::string_view getStringView() const { checkType(TSTRING); return *data.string; }
+#endif
 
             // Returns a member of a JSON object
-            inline Value& getMember(TString key) const { checkType(TOBJECT); return (*data.object)[key]; }
+            inline Value& getMember(const TString &key) const { checkType(TOBJECT); return (*data.object)[key]; }
 
             // Returns the size of a JSON array
             inline size_t getArraySize() const { checkType(TARRAY); return data.array->size(); }
@@ -139,6 +269,9 @@ namespace json {
             // Returns the Value at an index in a JSON array
             inline Value& getIndex(size_t index) const { checkType(TARRAY); return (*data.array)[index]; }
 
+            // Returns the elements of a JSON array, to iterate over without copying them (see also toVector)
+            inline const TArray& getArray() const { checkType(TARRAY); return *data.array; }
+
 #ifndef __CINT__
 
             // Templated casting functions (use these when possible / see below for default specializations)
@@ -162,7 +295,20 @@ namespace json {
             std::vector<std::string> getMembers() const;
 
             // Returns true if the key exists in the JSON object
-            bool isMember(std::string key) const;
+            bool isMember(const std::string &key) const;
+
+            // Returns a member of a JSON object, or NULL if there is none (unlike getMember, this never inserts).
+            // The pointer is valid until a member is added to the object.
+            inline Value *findMember(const char *key, size_t length) const {
+                checkType(TOBJECT);
+                TObject::iterator it = data.object->find(key, length);
+                return it == data.object->end() ? NULL : &it->second;
+            }
+            inline Value *findMember(const TString &key) const { return findMember(key.data(), key.size()); }
+            inline Value *findMember(const char *key) const { return findMember(key, strlen(key)); }
+#if __cplusplus >= 201703L
+            inline Value *findMember(std::string_view key) const { return findMember(key.data(), key.size()); }
+#endif
 
             // Setters will reset the type if necessary
             inline void setInteger(TInteger integer)  { checkTypeReset(TINTEGER); data.integer = integer; }
@@ -309,8 +455,102 @@ namespace json {
             std::string desc, pretty;
     };
 
+    //receives the values parsed by Reader::parse as events, in document order
+    class Handler {
+        public:
+            virtual ~Handler();
+
+            //An object begins; each member follows as a key() and then the member's value
+            virtual void startObject() = 0;
+
+            //The key of the next member, as written (not unescaped). It points into the Reader's buffer and
+            //stays valid for the life of the Reader.
+            virtual void key(const char *key, size_t length) = 0;
+
+            virtual void endObject() = 0;
+            virtual void startArray() = 0;
+            virtual void endArray() = 0;
+
+            //A string, unescaped in the Reader's buffer (valid like the keys)
+            virtual void string(const char *string, size_t length) = 0;
+
+            //A number, bool or null
+            virtual void scalar(const Value &value) = 0;
+
+            //Non-json array value repetition ([value:count]): the last element of the current array occurs
+            //count times in all (zero removes it)
+            virtual void repeat(size_t count) = 0;
+    };
+
+    //builds Values from parse events (Reader::getValue uses one)
+    class Builder : public Handler {
+        public:
+            Builder();
+            virtual ~Builder();
+
+            //Returns the last complete top-level value
+            inline Value &getResult() { return result; }
+
+            virtual void startObject();
+            virtual void key(const char *key, size_t length);
+            virtual void endObject();
+            virtual void startArray();
+            virtual void endArray();
+            virtual void string(const char *string, size_t length);
+            virtual void scalar(const Value &value);
+            virtual void repeat(size_t count);
+
+        protected:
+            //Called with every complete value before it is added to its container (or becomes the result).
+            //Returning false drops the value instead, so a subclass can consume parts of a document as they
+            //finish and never hold all of it. By default everything is kept. If a dropped array element is
+            //repeated ([value:count]), this is called again for each extra copy; a count of zero cannot take
+            //back a value already consumed.
+            virtual bool complete(Value &value);
+
+            //Returns the number of containers the value being built is in (0 at the top level)
+            inline size_t getDepth() const { return stack.size(); }
+
+            //Returns an open container, 0 being the outermost
+            inline const Value &getContainer(size_t depth) const { return stack[depth].container; }
+
+            //Returns true if the open object at a depth is reading the member with this key
+            inline bool isKey(size_t depth, const char *key) const {
+                const Frame &frame = stack[depth];
+                return frame.key && frame.length == strlen(key) && !memcmp(frame.key, key, frame.length);
+            }
+
+        private:
+            //An open container, the key of the member being read if it is an object, and whether its last
+            //value was kept (if not, the dropped value, in case it is repeated)
+            struct Frame {
+                Value container;
+                const char *key;
+                size_t length;
+                bool kept;
+                Value dropped;
+            };
+
+            //Adds a complete value to the innermost container, or makes it the result
+            void add(Value &value);
+
+            std::vector<Frame> stack;
+            Value result;
+    };
+
+    //names a file for Reader to memory-map (a plain string is parsed as JSON text)
+    struct MapFile {
+        explicit MapFile(const std::string &path_) : path(path_) { }
+        std::string path;
+    };
+
     //parses JSON values from a stream
     class Reader {
+        private:
+            //Owns its buffer or mapping, so it cannot be copied
+            Reader(const Reader &);
+            Reader& operator=(const Reader &);
+
         public:
             //Reads entire stream into internal buffer immediately
             Reader(std::istream &stream);
@@ -318,24 +558,44 @@ namespace json {
             //Copies the entire string into an internal buffer
             Reader(const std::string &str);
 
+            //Maps the file privately (copy-on-write) and parses it in place, without reading it into a buffer
+            Reader(const MapFile &file);
+
             ~Reader();
 
+            //Builds the following values in an arena instead of on the heap (NULL to go back to the heap)
+            inline void setArena(Arena *arena_) { arena = arena_; }
+
             //Returns the next value in the stream
             bool getValue(Value &result);
 
+            //Sends the next value in the stream to a handler as events, returning false at the end of the stream
+            bool parse(Handler &handler);
+
         protected:
             //Positional data in the stream data (gets garbled during parsing)
             char *data,*cur,*lastbr;
             int line;
 
-            //Converts an escaped JSON string into its literal representation
-            std::string unescapeString(std::string string);
+            //Length of the file mapping at data, or 0 if data was allocated with new[]
+            size_t mapped;
+
+            //Where parsed values are allocated, NULL for the heap
+            Arena *arena;
 
-            //Helpers to read JSON types
+            //Builds the values returned by getValue, kept to reuse its stack
+            Builder builder;
+
+            //Scans a string from cur (just past the opening quote) to the closing quote, unescaping it in place
+            //unless told not to (object keys are kept as written). Returns the end of the string, which is not
+            //terminated, and leaves cur after the quote. Only strings with escapes are written to.
+            char *scanString(bool unescape = true);
+
+            //Helpers to read JSON types, sending the structured ones to a handler
             Value readNumber();
-            Value readString();
-            Value readObject();
-            Value readArray();
+            void readString(Handler &handler);
+            void readObject(Handler &handler);
+            void readArray(Handler &handler);
 
             void skipComment();
 
@@ -344,26 +604,50 @@ namespace json {
     //writes JSON values to a stream
     class Writer {
         public:
-            //Only writes to the stream when requested
-            Writer(std::ostream &stream);
+            //Only writes to the stream when requested. Compact output has no whitespace between tokens.
+            Writer(std::ostream &stream, bool compact = false);
 
             ~Writer();
 
             //This produces JSON compliant output at the expense of:
             //***Unsigned integers get printed as base 10 numbers, and the next parser may truncate into signed
             //Ultimately produces object-indented text with value-per-line mentality with arrays on a single line
-            //which is similar enough to how RATDB looks without too much effort.
+            //which is similar enough to how RATDB looks without too much effort. Each value is followed by a
+            //newline, and is in the stream when this returns.
             void putValue(const Value &value);
 
         protected:
             //The stream to write to
             std::ostream &out;
 
-            //Converts a literal string to its escaped representation
-            std::string escapeString(std::string string);
+            //Whether to leave out indentation and spaces
+            bool compact;
+
+            //Output is collected here and passed to the stream in large blocks
+            static const size_t BUFFER_SIZE = 1 << 15;
+            char buffer[BUFFER_SIZE];
+            size_t used;
+
+            //Appends to the buffer
+            inline void put(char c) { if (used == BUFFER_SIZE) flush(); buffer[used++] = c; }
+            void put(const char *str, size_t length);
+
+            //Appends a newline and the indentation of a nesting level
+            void putIndent(int depth);
+
+            //Appends a string in quotes, escaping it on the way
+            void putString(const char *str, size_t length);
+
+            //Appends numbers without going through the stream
+            void putInteger(TInteger integer);
+            void putUInteger(TUInteger uinteger);
+            void putReal(TReal real);
+
+            //Passes the buffer to the stream
+            void flush();
 
-            //Helper to write a value to the stream
-            void writeValue(const Value &value, const std::string &depth = "");
+            //Helper to write a value to the buffer
+            void writeValue(const Value &value, int depth = 0);
 
     };
 
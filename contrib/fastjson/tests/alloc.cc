@@ -0,0 +1,66 @@
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <sys/time.h>
+
+#include "json.hh"
+
+using namespace std;
+
+// Counts every heap allocation and free made through operator new and delete
+static size_t allocations = 0, frees = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    if (p) frees++;
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    if (p) frees++;
+    free(p);
+}
+
+static double now() {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+// Parses a file with and without an arena, reporting heap allocations and frees and the time for parsing and teardown
+int main(int argc, char **argv) {
+    for (int arena_mode = 0; arena_mode < 2; arena_mode++) {
+        size_t n = 0, parse_allocs, teardown_frees;
+        double t0 = now(), t1, t2;
+        {
+            json::Arena *arena = arena_mode ? new json::Arena() : NULL;
+            {
+                json::Reader reader((json::MapFile(argv[1])));
+                reader.setArena(arena);
+                vector<json::Value> values;
+                json::Value value;
+                size_t before = allocations;
+                while (reader.getValue(value)) {
+                    values.push_back(value);
+                    n++;
+                }
+                parse_allocs = allocations - before;
+                t1 = now();
+                before = frees;
+                values.clear();
+                value.reset();
+                delete arena;
+                teardown_frees = frees - before;
+            }
+            t2 = now();
+        }
+        cout << (arena_mode ? "arena " : "heap  ") << n << " values: " << parse_allocs << " allocations in "
+             << (t1 - t0) << " s, teardown " << (t2 - t1) << " s (" << teardown_frees << " frees)\n";
+    }
+}
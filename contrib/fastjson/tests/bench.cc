@@ -0,0 +1,83 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "json.hh"
+
+using namespace std;
+
+// Parses every value in a file, by stream or by memory mapping
+static size_t parse(const char *path, bool map) {
+    size_t n = 0;
+    json::Value value;
+    if (map) {
+        json::Reader reader((json::MapFile(path)));
+        while (reader.getValue(value)) n++;
+    } else {
+        ifstream file(path);
+        json::Reader reader(file);
+        while (reader.getValue(value)) n++;
+    }
+    return n;
+}
+
+// Times one parse in a child process, so that each method's peak memory is measured on its own
+static void run(const char *path, bool map, double mb) {
+    struct timeval t0, t1;
+    gettimeofday(&t0, NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        parse(path, map);
+        _exit(0);
+    }
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    gettimeofday(&t1, NULL);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) * 1e-6;
+    cout << (map ? "mmap   " : "stream ") << secs << " s, " << mb / secs << " MB/s, peak RSS "
+         << usage.ru_maxrss / 1024 << " MB" << '\n';
+}
+
+// Usage: bench MB fixture... (builds a file of about MB megabytes from the fixtures, then parses it both ways)
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cerr << "usage: " << argv[0] << " MB fixture...\n";
+        return 1;
+    }
+    const size_t target = atof(argv[1]) * (1 << 20);
+
+    string fixtures;
+    for (int i = 2; i < argc; i++) {
+        ifstream file(argv[i]);
+        stringstream ss;
+        ss << file.rdbuf();
+        fixtures += ss.str() + '\n';
+    }
+
+    char path[] = "/tmp/fastjson_bench_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *out = fdopen(fd, "w");
+    size_t size = 0;
+    while (size < target) {
+        fwrite(fixtures.data(), 1, fixtures.size(), out);
+        size += fixtures.size();
+    }
+    fclose(out);
+
+    double mb = size / double(1 << 20);
+    cout << "values: " << parse(path, false) << " in " << mb << " MB\n";
+    for (int i = 0; i < 3; i++) {
+        run(path, false, mb);
+        run(path, true, mb);
+    }
+
+    unlink(path);
+}
@@ -2,3 +2,7 @@
 g++ -O4 -pedantic -Wall -std=c++11 -I ../ -o echo  ../*.cc echo.cc
 g++ -O4 -pedantic -Wall -std=c++11 -I ../ -o tovector  ../*.cc tovector.cc
 g++ -O4 -pedantic -Wall -std=c++11 -I ../ -o stats  ../*.cc stats.cc
+g++ -O4 -pedantic -Wall -std=c++11 -I ../ -o bench  ../*.cc bench.cc
+g++ -O4 -pedantic -Wall -std=c++11 -I ../ -o alloc  ../*.cc alloc.cc
+g++ -O4 -pedantic -Wall -std=c++11 -I ../ -o events  ../*.cc events.cc
+g++ -O4 -pedantic -Wall -std=c++11 -I ../ -o wbench  ../*.cc wbench.cc
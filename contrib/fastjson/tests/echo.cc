@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <cstring>
 
 #include "json.hh"
 
@@ -7,18 +8,23 @@ using namespace std;
 
 int main(int argc, char **argv) {
     
+    // echo -m FILE parses through a memory mapping instead of a stream
+    bool map = argc > 2 && strcmp(argv[1], "-m") == 0;
+    const char *path = argv[map ? 2 : 1];
+
     ifstream file;
-    file.open(argv[1]);
-    json::Reader reader(file);
+    file.open(path);
+    json::Reader *reader = map ? new json::Reader(json::MapFile(path)) : new json::Reader(file);
     
     json::Writer writer(cout);
     try {
 		json::Value value;
-		while (reader.getValue(value)) {
+		while (reader->getValue(value)) {
 			writer.putValue(value);
 		}
 	} catch (json::parser_error e) {
 		cout << "ERROR: " << e.what() << '\n';
 	}
 
+    delete reader;
 }
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <string>
+
+#include "json.hh"
+
+using namespace std;
+
+// Prints parse events, one per line, indented by depth
+class Printer : public json::Handler {
+    public:
+        Printer() : depth(0) { }
+
+        void startObject() { line("startObject"); depth++; }
+        void key(const char *key, size_t length) { line("key " + std::string(key, length)); }
+        void endObject() { depth--; line("endObject"); }
+        void startArray() { line("startArray"); depth++; }
+        void endArray() { depth--; line("endArray"); }
+        void string(const char *string, size_t length) { line("string " + std::string(string, length)); }
+        void scalar(const json::Value &value) { line("scalar " + value.cast<std::string>()); }
+        void repeat(size_t count) { cout << std::string(2*depth, ' ') << "repeat " << count << '\n'; }
+
+    private:
+        void line(const std::string &text) { cout << std::string(2*depth, ' ') << text << '\n'; }
+
+        int depth;
+};
+
+// Writes each element of a top-level array as soon as it is complete, and drops it
+class Streamer : public json::Builder {
+    public:
+        Streamer() : writer(cout), count(0) { }
+
+        size_t getCount() const { return count; }
+
+    protected:
+        bool complete(json::Value &value) {
+            if (getDepth() != 1 || getContainer(0).getType() != json::TARRAY) return true;
+            writer.putValue(value);
+            count++;
+            return false;
+        }
+
+        json::Writer writer;
+        size_t count;
+};
+
+int main(int argc, char **argv) {
+
+    // events -s FILE streams the elements of top-level arrays instead of printing events
+    bool stream = argc > 2 && strcmp(argv[1], "-s") == 0;
+    json::Reader reader((json::MapFile(argv[stream ? 2 : 1])));
+
+    try {
+        if (stream) {
+            Streamer streamer;
+            while (reader.parse(streamer)) { }
+            cout << streamer.getCount() << " elements\n";
+        } else {
+            Printer printer;
+            while (reader.parse(printer)) { }
+        }
+    } catch (json::parser_error &e) {
+        cout << "ERROR: " << e.what() << '\n';
+    }
+}
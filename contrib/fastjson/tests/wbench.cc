@@ -0,0 +1,174 @@
+#include <iostream>
+#include <sstream>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+#include "json.hh"
+
+using namespace std;
+
+// Discards what is written to it, counting the bytes
+class NullBuffer : public streambuf {
+    public:
+        NullBuffer() : count(0) { }
+        size_t count;
+    protected:
+        streamsize xsputn(const char *, streamsize n) { count += n; return n; }
+        int overflow(int c) { count++; return c; }
+};
+
+// The writer before it was rewritten for speed, kept as a reference: every token goes through ostream insertion,
+// strings are escaped through a stringstream, and reals are written with digits10 precision. Indented output only.
+class ReferenceWriter {
+    public:
+        ReferenceWriter(ostream &stream, bool = false) : out(stream) { }
+
+        void putValue(const json::Value &value) {
+            writeValue(value, "");
+            out << '\n';
+        }
+
+    private:
+        ostream &out;
+
+        // Value has no public object iterator, so members are looked up by key; this costs little next to the arrays
+        void writeValue(const json::Value &value, const string &depth = "") {
+            switch (value.getType()) {
+                case json::TINTEGER:
+                    out << value.getInteger();
+                    break;
+                case json::TUINTEGER:
+                    out << value.getUInteger();
+                    break;
+                case json::TREAL:
+                    out.precision(numeric_limits<double>::digits10);
+                    out << value.getReal();
+                    break;
+                case json::TSTRING:
+                    out << '"' << escapeString(value.getString()) << '"';
+                    break;
+                case json::TOBJECT: {
+                        const string nextdepth(depth + "    ");
+                        vector<string> keys = value.getMembers();
+                        out << "{\n";
+                        for (size_t i = 0; i < keys.size(); i++) {
+                            out << (i ? ",\n" : "") << nextdepth << '\"' << keys[i] << "\" : ";
+                            writeValue(*value.findMember(keys[i]), nextdepth);
+                        }
+                        out << '\n' << depth << '}';
+                    }
+                    break;
+                case json::TARRAY: {
+                        const json::TArray &array = value.getArray();
+                        out << '[';
+                        for (size_t i = 0; i < array.size(); i++) {
+                            if (i) out << ", ";
+                            writeValue(array[i]);
+                        }
+                        out << ']';
+                    }
+                    break;
+                case json::TNULL:
+                    out << "null";
+                    break;
+                case json::TBOOL:
+                    out << (value.getBool() ? "true" : "false");
+            }
+        }
+
+        string escapeString(string unescaped) {
+            stringstream escaped;
+            size_t last = 0, pos = 0, len = unescaped.length();
+            while (pos < len) {
+                switch (unescaped[pos]) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        escaped << unescaped.substr(last, pos - last) << '\\' << unescaped[pos];
+                        last = pos + 1;
+                        break;
+                    case '\b':
+                        escaped << unescaped.substr(last, pos - last) << "\\b";
+                        last = pos + 1;
+                        break;
+                    case '\f':
+                        escaped << unescaped.substr(last, pos - last) << "\\f";
+                        last = pos + 1;
+                        break;
+                    case '\n':
+                        escaped << unescaped.substr(last, pos - last) << "\\n";
+                        last = pos + 1;
+                        break;
+                    case '\r':
+                        escaped << unescaped.substr(last, pos - last) << "\\r";
+                        last = pos + 1;
+                        break;
+                    case '\t':
+                        escaped << unescaped.substr(last, pos - last) << "\\t";
+                        last = pos + 1;
+                        break;
+                    default:
+                        if (unescaped[pos] < 0x20) throw json::parser_error(0, 0, "Arbitrary unicode escapes not yet supported");
+                }
+                pos++;
+            }
+            escaped << unescaped.substr(last, pos - last);
+            return escaped.str();
+        }
+};
+
+static double now() {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+// Writes the document a few times, reporting the output rate
+template <typename W> static void run(const json::Value &doc, const char *label, bool compact = false) {
+    for (int i = 0; i < 3; i++) {
+        NullBuffer buffer;
+        ostream out(&buffer);
+        double t0 = now();
+        W writer(out, compact);
+        writer.putValue(doc);
+        double secs = now() - t0;
+        double mb = buffer.count / double(1 << 20);
+        cout << label << mb << " MB in " << secs << " s, " << mb / secs << " MB/s\n";
+    }
+}
+
+// Usage: wbench NHIST (writes NHIST histograms of 100 bins, like a data export)
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " NHIST\n";
+        return 1;
+    }
+    const int nhist = atoi(argv[1]);
+
+    json::Value doc(json::TARRAY);
+    doc.setArraySize(nhist);
+    for (int i = 0; i < nhist; i++) {
+        vector<double> bins(100), errors(100);
+        for (size_t j = 0; j < bins.size(); j++) {
+            bins[j] = 1e-39 * (rand() % 100000) * (j + 1);
+            errors[j] = bins[j] * 0.1;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "Sample_%d", i);
+        json::Value hist(json::TOBJECT);
+        hist.setMember("sample", json::Value(string(name)));
+        hist.setMember("title", json::Value(string("d#sigma/dp_{#mu} (cm^{2}/GeV/c)\tper nucleon")));
+        hist.setMember("nbins", json::Value((int) bins.size()));
+        hist.setMember("content", json::Value(bins));
+        hist.setMember("error", json::Value(errors));
+        doc.setIndex(i, hist);
+    }
+
+    run<ReferenceWriter>(doc, "reference ");
+    run<json::Writer>(doc, "indented  ");
+    run<json::Writer>(doc, "compact   ", true);
+}
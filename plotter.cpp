@@ -4,14 +4,26 @@
  * A. Mastbaum, D. Cherdack, N. de la Cruz, T. Singh
  */
 
+#include <algorithm>
 #include <cassert>
-#include <fstream>
+#include <sys/stat.h>
 #include <iostream>
 #include <string>
 #include "json.hh"
 #include "TStyle.h"
 
 #include "Options.h"
+#include "CanvasPool.h"
+#include "Chi2Engine.h"
+#include "ConfigBuilder.h"
+#include "FilePool.h"
+#include "HistCache.h"
+#include "StageCache.h"
+#include "HistBundle.h"
+#include "Hash.h"
+#include "Gallery.h"
+#include "Manifest.h"
+#include "WorkerPool.h"
 #include "Generator.h"
 #include "Plot.h"
 #include "Plot1D.h"
@@ -28,25 +40,14 @@ int main(int argc, char* argv[]) {
   gStyle->SetOptStat(0);
   gStyle->SetOptTitle(0);
 
-  // Read JSON config
-  std::ifstream config_file(opts.config);
-  json::Reader reader(config_file);
-  json::Value data;
-  reader.getValue(data);
-  assert(data.getType() != json::TNULL);
-
-  // Generator configuration
-  std::vector<Generator*> gens;
-  json::Value& gen_config = data.getMember("generators");
-  for (size_t i=0; i<gen_config.getArraySize(); i++) {
-    gens.push_back(new Generator(gen_config.getIndex(i)));
-  }
-
-  // Plot configuration
+  // Plot configuration. Plots are built from their config blocks as the
+  // blocks are parsed, so the blocks are never all in memory at once. Keep
+  // a hash of each plot's config block, for its fingerprint.
+  size_t nskipped = 0;
   std::vector<Plot*> plots;
-  json::Value& plot_config = data.getMember("plots");
-  for (size_t i=0; i<plot_config.getArraySize(); i++) {
-    json::Value& cfg = plot_config.getIndex(i);
+  std::vector<uint64_t> plot_hashes;
+  ConfigBuilder builder([&](json::Value& cfg) {
+    uint64_t cfg_hash = Hash().add(cfg.toJSONString()).value;
     switch (Plot::getType(cfg)) {
       case Plot::k1D:
         plots.push_back(new Plot1D(cfg));
@@ -60,24 +61,294 @@ int main(int argc, char* argv[]) {
       case Plot::k3D:
       default:
         std::cerr << "Not implemented" << std::endl;
-        break;
+        nskipped++;
+        return;
+    }
+    plot_hashes.push_back(cfg_hash);
+  });
+
+  // Read JSON config, parsing the file in place through a memory mapping.
+  // Everything but the plot blocks is kept.
+  json::Reader reader((json::MapFile(opts.config)));
+  json::Value data;
+  if (reader.parse(builder)) {
+    data = builder.getResult();
+  }
+  assert(data.getType() != json::TNULL);
+
+  // Output formats, from the command line or else the config (default is
+  // PDF and ROOT macro). In book mode only the book is written unless
+  // formats are given explicitly.
+  if (!opts.formats.empty()) {
+    Plot::formats = opts.formats;
+  }
+  else if (data.isMember("formats")) {
+    json::Value& fmt = data.getMember("formats");
+    Plot::formats.clear();
+    for (size_t i=0; i<fmt.getArraySize(); i++) {
+      Plot::formats.push_back(fmt.getIndex(i).getString());
+    }
+  }
+  else if (!opts.book.empty()) {
+    Plot::formats.clear();
+  }
+
+  for (const std::string& format : Plot::formats) {
+    if (!Plot::isFormat(format)) {
+      std::cerr << "Unknown output format: " << format << std::endl;
+      return 1;
+    }
+  }
+
+  if (opts.renderer == "native") {
+    Plot::renderer = Plot::kRenderNative;
+  }
+
+  Plot::gallery = opts.gallery;
+
+  // Output file name (without extension) for each plot
+  auto output_name = [&](size_t i) {
+    Plot* plot = plots[i];
+    std::string proj = "";
+    if (plot->type == Plot::k2DProjection) {
+      proj = ((Plot2DProjection*) plot)->projection == Plot2DProjection::kX ? "_x" : "_y";
+    }
+    return plot->sample + proj;
+  };
+
+  // Stage generator files on a local disk, if enabled. This is done before
+  // forking, so each file is copied once.
+  json::Value& gen_config = data.getMember("generators");
+  if (!opts.stage_dir.empty()) {
+    StageCache stage(opts.stage_dir, uint64_t(opts.stage_size) << 20);
+    for (size_t i=0; i<gen_config.getArraySize(); i++) {
+      json::Value& g = gen_config.getIndex(i);
+      g.setMember("filename", json::Value(stage.stage(g.getMember("filename").getString())));
     }
   }
 
+  // Generator configuration. Generators are loaded in each worker process,
+  // so that every worker has its own ROOT file handles. Workers claim plots
+  // a batch at a time, plan the objects the batch needs and prefetch them
+  // with batched reads, so that memory use does not grow with the number of
+  // plots.
+  //
+  // Plots are skipped if they were last drawn from exactly the same inputs:
+  // the fingerprint covers the plot's config block, the generator settings,
+  // the key of every object the plot reads (from the directory listing, so
+  // checking costs no reads), and the plotter version.
+  FilePool files(opts.max_files);
+  HistCache cache(uint64_t(opts.cache_size) << 20);
+  CanvasPool canvases;  // Reused between plots of the same shape
+  Plot::canvases = &canvases;
+  Chi2Engine chi2(uint64_t(256) << 20);  // Covariance factors, shared by generators
+  Plot::chi2_engine = &chi2;
+  std::vector<Generator*> gens;
+  Manifest manifest("plotter.manifest");
+  std::vector<std::string> fingerprints(plots.size());
+  std::vector<bool> stale(plots.size(), true);
+  const size_t batch_size = 64;  // Plots claimed and prefetched at a time
+
+  // Every plot is a page in the book, so all are drawn, in order, by a
+  // single process
+  bool book = !opts.book.empty();
+  if (book && opts.njobs > 1) {
+    std::cout << "Book mode: drawing with one process" << std::endl;
+    opts.njobs = 1;
+  }
+
+  auto fingerprint = [&](size_t i) {
+    Hash hash;
+    hash.add(std::string(Manifest::version));
+    hash.add(plot_hashes[i]);
+    for (const std::string& format : Plot::formats) {
+      hash.add(format);
+    }
+    hash.add(opts.renderer);
+    for (Generator* gen : gens) {
+      hash.add(gen->title).add(uint64_t(gen->color));
+      hash.add(gen->getContentHash("likelihood_hist"));
+      hash.add(gen->getContentHash("ndof_hist"));
+      for (const std::string& key : plots[i]->getKeys(gen, gen == gens[0])) {
+        hash.add(key).add(gen->getContentHash(key));
+      }
+    }
+    return hash.hex();
+  };
+
+  auto make_generators = [&]() {
+    for (size_t i=0; i<gen_config.getArraySize(); i++) {
+      gens.push_back(new Generator(gen_config.getIndex(i), &files, &cache));
+    }
+  };
+
+  // Fingerprint a batch of plots, then prefetch what the stale ones need.
+  // The data are read from the first generator only.
+  auto start_batch = [&](const std::vector<size_t>& tasks) {
+    for (size_t i : tasks) {
+      fingerprints[i] = fingerprint(i);
+      stale[i] = (book || opts.force ||
+                  !manifest.isCurrent(output_name(i), fingerprints[i]));
+      for (const std::string& format : Plot::formats) {
+        struct stat st;
+        if (stat(Plot::outputPath(output_name(i), format).c_str(), &st) != 0) {
+          stale[i] = true;
+        }
+      }
+
+      struct stat st;
+      if (!opts.gallery.empty() &&
+          (stat(Gallery::thumbnailPath(opts.gallery, output_name(i)).c_str(), &st) != 0 ||
+           stat(Gallery::chi2Path(opts.gallery, output_name(i)).c_str(), &st) != 0)) {
+        stale[i] = true;
+      }
+    }
+
+    for (Generator* gen : gens) {
+      std::vector<std::string> keys;
+      for (size_t i : tasks) {
+        if (!stale[i]) continue;
+        std::vector<std::string> plot_keys = plots[i]->getKeys(gen, gen == gens[0]);
+        keys.insert(keys.end(), plot_keys.begin(), plot_keys.end());
+      }
+      gen->prefetch(keys);
+    }
+  };
+
+  // Check mode: resolve every plot against every generator, report any
+  // problems, and exit without drawing
+  if (opts.check) {
+    size_t nproblems = nskipped;
+    for (size_t i=0; i<gen_config.getArraySize(); i++) {
+      json::Value& g = gen_config.getIndex(i);
+      std::string title = g.getMember("title").getString();
+      std::string filename = g.getMember("filename").getString();
+      bool readable = (HistBundle::isBundle(filename) ? HistBundle(filename).isOpen()
+                                                      : files.get(filename) != nullptr);
+      if (!readable) {
+        std::cout << title << ": Unable to open " << filename << std::endl;
+        nproblems++;
+        continue;
+      }
+
+      Generator* gen = new Generator(g, &files, &cache);
+      if (gen->getChi2Table().empty()) {
+        std::cout << title << ": No chi2 summary (likelihood_hist, ndof_hist)" << std::endl;
+        nproblems++;
+      }
+      gens.push_back(gen);
+    }
+
+    for (Plot* plot : plots) {
+      for (const std::string& problem : plot->check(gens)) {
+        std::cout << plot->sample << ": " << problem << std::endl;
+        nproblems++;
+      }
+    }
+
+    std::cout << "Checked " << plots.size() << " plots against " << gens.size()
+              << " generators: " << nproblems << " problems found." << std::endl;
+
+    return nproblems > 0 ? 1 : 0;
+  }
+
   // Build overlay plots
-  for (Plot* plot : plots) {
+  auto draw_plot = [&](size_t i) {
+    Plot* plot = plots[i];
+    if (!stale[i]) {
+      std::cout << plot->sample << ": Up to date" << std::endl;
+      return true;
+    }
+
     std::cout << plot->sample << std::endl;
     for (Generator* gen : gens) {
       plot->add(gen);
     }
 
-    std::string proj = "";
-    if (plot->type == Plot::k2DProjection) {
-      proj = ((Plot2DProjection*) plot)->projection == Plot2DProjection::kX ? "_x" : "_y";
+    plot->draw(output_name(i));
+    plot->clear();
+    manifest.record(output_name(i), fingerprints[i]);
+    return true;
+  };
+
+  if (book) {
+    Plot::openBook(opts.book);
+  }
+
+  // The workers write thumbnails into the gallery, so create it first
+  Gallery* gallery = opts.gallery.empty() ? nullptr : new Gallery(opts.gallery);
+
+  WorkerPool pool(opts.njobs, batch_size);
+  std::vector<bool> ok = pool.run(plots.size(), draw_plot, make_generators,
+                                  [&]() {
+                                    cache.printStats();
+                                    canvases.printStats();
+                                    if (chi2.misses > 0) {
+                                      chi2.printStats();
+                                    }
+                                  },
+                                  start_batch);
+
+  if (book) {
+    Plot::closeBook();
+  }
+
+  manifest.compact();
+
+  // Gallery index. Thumbnails and the legend chi2 were recorded by the
+  // workers as plots were saved. Where the legends have no single value per
+  // generator, the whole-sample chi2 comes from the generators, loaded here
+  // if the drawing happened in other processes.
+  if (gallery) {
+    for (size_t i=0; i<plots.size(); i++) {
+      Gallery::Entry entry;
+      entry.sample = plots[i]->sample;
+      entry.name = output_name(i);
+      if (!Plot::formats.empty()) {
+        entry.link = Plot::outputPath(entry.name, Plot::formats[0]);
+      }
+      else {
+        entry.link = book ? opts.book : Gallery::thumbnailPath(opts.gallery, entry.name);
+      }
+
+      Gallery::readChi2(Gallery::chi2Path(opts.gallery, entry.name), entry.chi2);
+      if (entry.chi2.empty()) {
+        if (gens.empty()) {
+          make_generators();
+        }
+
+        for (Generator* gen : gens) {
+          bool has_chi2 = !gen->getChi2Table().empty();
+          std::string chi2 = has_chi2 ? gen->getChi2String(plots[i]->sample) : "/";
+          if (plots[i]->chi2_range) {
+            chi2 += " (all bins)";
+          }
+          entry.chi2.emplace_back(gen->title, chi2);
+        }
+      }
+      gallery->add(entry);
     }
-    plot->draw(plot->sample + proj);
+    gallery->write();
+    delete gallery;
+  }
+
+  // Report failures in plot order
+  size_t nfailed = 0;
+  for (size_t i=0; i<plots.size(); i++) {
+    if (!ok[i]) {
+      std::cerr << plots[i]->sample << ": FAILED" << std::endl;
+      nfailed++;
+    }
+  }
+
+  for (Plot* plot : plots) {
+    delete plot;
+  }
+
+  for (Generator* gen : gens) {
+    delete gen;
   }
 
-  return 0;
+  return nfailed > 0 ? 1 : 0;
 }
 
@@ -0,0 +1,107 @@
+/**
+ * Check Chi2Engine::cholesky: L L^T must reproduce the input for sizes
+ * around the block size, and a matrix that is not positive definite must be
+ * rejected. Exits nonzero on failure.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Chi2Engine.h"
+
+namespace {
+
+size_t nfailed = 0;
+
+/**
+ * A random symmetric positive definite matrix, B B^T + n I.
+ *
+ * @param n Matrix dimension
+ * @returns The matrix, row major
+ */
+std::vector<double> makeSPD(size_t n) {
+  std::vector<double> b(n * n), a(n * n);
+  for (double& x : b) x = 2 * drand48() - 1;
+
+  for (size_t i=0; i<n; i++) {
+    for (size_t j=0; j<=i; j++) {
+      double s = (i == j) ? n : 0;
+      for (size_t k=0; k<n; k++) {
+        s += b[i * n + k] * b[j * n + k];
+      }
+      a[i * n + j] = a[j * n + i] = s;
+    }
+  }
+  return a;
+}
+
+
+/** Factor a positive definite matrix and compare L L^T with it. */
+void checkFactor(size_t n) {
+  std::vector<double> a = makeSPD(n);
+  std::vector<double> l = a;
+  if (!Chi2Engine::cholesky(l, n)) {
+    printf("FAIL n=%lu: rejected a positive definite matrix\n", n);
+    nfailed++;
+    return;
+  }
+
+  double worst = 0;
+  for (size_t i=0; i<n; i++) {
+    if (!(l[i * n + i] > 0)) {
+      printf("FAIL n=%lu: L[%lu][%lu] = %g\n", n, i, i, l[i * n + i]);
+      nfailed++;
+    }
+    for (size_t j=0; j<=i; j++) {
+      double s = 0;
+      for (size_t k=0; k<=j; k++) {
+        s += l[i * n + k] * l[j * n + k];
+      }
+      worst = std::max(worst, std::fabs(s - a[i * n + j]) / std::fabs(a[i * n + i]));
+    }
+  }
+
+  if (worst > 1e-12) {
+    printf("FAIL n=%lu: L L^T differs from the input by %g\n", n, worst);
+    nfailed++;
+  }
+}
+
+
+/** A matrix that is not positive definite must be rejected. */
+void checkReject(const char* what, std::vector<double> a, size_t n) {
+  if (Chi2Engine::cholesky(a, n)) {
+    printf("FAIL %s (n=%lu): accepted a matrix that is not positive definite\n", what, n);
+    nfailed++;
+  }
+}
+
+}  // namespace
+
+
+int main(int argc, char* argv[]) {
+  srand48(1);
+
+  // Below, at and around the 64-row block size, and over two blocks
+  for (size_t n : { 1, 2, 63, 64, 65, 130 }) {
+    checkFactor(n);
+  }
+
+  // Indefinite 2x2, with eigenvalues 3 and -1
+  checkReject("indefinite", { 1, 2, 2, 1 }, 2);
+
+  // Singular
+  checkReject("zero", std::vector<double>(9, 0), 3);
+
+  // Indefinite only past the first block, so it fails in the trailing update
+  size_t n = 130;
+  std::vector<double> a = makeSPD(n);
+  a[100 * n + 100] = -1;
+  checkReject("indefinite in the second block", a, n);
+
+  printf("cholesky: %lu failures\n", nfailed);
+  return nfailed > 0 ? 1 : 0;
+}
+
@@ -0,0 +1,140 @@
+/**
+ * Check the histogram bin kernels against plain loops.
+ *
+ * Build it once as is and once with -mno-sse2, so that both the SSE2 and
+ * the scalar code are tested (see `make test`). Exits nonzero on failure.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "HistKernels.h"
+
+namespace {
+
+size_t nfailed = 0;
+
+/** Report a failed check. */
+void fail(const std::string& what, size_t n, const char* field, double got, double want) {
+  printf("FAIL %s n=%lu: %s = %g, expected %g\n", what.c_str(), n, field, got, want);
+  nfailed++;
+}
+
+
+/** Compare with a relative tolerance, for sums whose order differs. */
+bool close(double a, double b) {
+  return std::fabs(a - b) <= 1e-12 * std::max(1.0, std::fabs(b));
+}
+
+
+/** binStats, one bin at a time, in order. */
+BinStats reference(const double* content, const double* error2, size_t n) {
+  BinStats s;
+  for (size_t i=0; i<n; i++) {
+    double c = content[i];
+    double e2 = error2 ? error2[i] : std::fabs(c);
+    if (i == 0 || c > s.max) {
+      s.max = c;
+      s.imax = i;
+      s.max_error2 = e2;
+    }
+    double v = c + std::sqrt(e2);
+    if (i == 0 || v > s.max_plus_error) s.max_plus_error = v;
+    s.integral += c;
+  }
+  return s;
+}
+
+
+/** Check binStats on one input, with and without squared errors. */
+void check(const std::string& what, const std::vector<double>& content,
+           const std::vector<double>& error2) {
+  size_t n = content.size();
+  for (int poisson=0; poisson<2; poisson++) {
+    const double* e2 = poisson ? nullptr : error2.data();
+    std::string name = what + (poisson ? " (Poisson)" : "");
+    BinStats got = binStats(content.data(), e2, n);
+    BinStats want = reference(content.data(), e2, n);
+
+    if (got.imax != want.imax) fail(name, n, "imax", got.imax, want.imax);
+    if (got.max != want.max) fail(name, n, "max", got.max, want.max);
+    if (got.max_error2 != want.max_error2) {
+      fail(name, n, "max_error2", got.max_error2, want.max_error2);
+    }
+    if (!close(got.max_plus_error, want.max_plus_error)) {
+      fail(name, n, "max_plus_error", got.max_plus_error, want.max_plus_error);
+    }
+    if (!close(got.integral, want.integral)) {
+      fail(name, n, "integral", got.integral, want.integral);
+    }
+  }
+}
+
+}  // namespace
+
+
+int main(int argc, char* argv[]) {
+  srand48(1);
+
+  // Every size from empty up to a few SIMD steps, so that each lane and the
+  // odd tail hold the maximum in turn
+  for (size_t n=0; n<=17; n++) {
+    std::vector<double> content(n), error2(n);
+    for (size_t i=0; i<n; i++) {
+      content[i] = 100 * drand48() - 20;
+      error2[i] = 10 * drand48();
+    }
+    check("random", content, error2);
+
+    for (size_t k=0; k<n; k++) {
+      std::vector<double> peak(content);
+      peak[k] = 1000;
+      check("peak at " + std::to_string(k), peak, error2);
+    }
+  }
+
+  // Ties: the first maximum wins, whichever lane or tail it is in
+  for (size_t n=1; n<=17; n++) {
+    std::vector<double> error2(n);
+    for (size_t i=0; i<n; i++) error2[i] = i + 1;
+
+    check("constant", std::vector<double>(n, 5), error2);
+
+    for (size_t a=0; a<n; a++) {
+      for (size_t b=a+1; b<n; b++) {
+        std::vector<double> content(n, 1);
+        content[a] = content[b] = 7;
+        check("tie at " + std::to_string(a) + "," + std::to_string(b), content, error2);
+      }
+    }
+  }
+
+  // All negative, so nothing beats the first bin's starting value
+  for (size_t n=1; n<=9; n++) {
+    std::vector<double> content(n), error2(n, 1);
+    for (size_t i=0; i<n; i++) content[i] = -1.0 - i;
+    check("decreasing", content, error2);
+  }
+
+  // Long random histograms, odd and even
+  for (size_t n : { 999, 1000, 4097 }) {
+    std::vector<double> content(n), error2(n);
+    for (size_t i=0; i<n; i++) {
+      content[i] = std::floor(50 * drand48());  // Many ties
+      error2[i] = content[i];
+    }
+    check("long", content, error2);
+  }
+
+#ifdef __SSE2__
+  const char* mode = "SSE2";
+#else
+  const char* mode = "scalar";
+#endif
+  printf("binStats (%s): %lu failures\n", mode, nfailed);
+  return nfailed > 0 ? 1 : 0;
+}
+
@@ -0,0 +1,98 @@
+#!/bin/bash
+#
+# Peak memory regression test: the plotter's peak RSS must not grow with
+# the number of plots. Draws about 10 and 1000 plots over one small
+# synthetic nuiscomp file (data export only, no graphics) and checks that
+# the peak resident set sizes are within a fixed margin.
+#
+# Usage: tests/memory.sh [path/to/plotter]
+#
+# Needs ROOT (root-config and root on the PATH) and GNU time.
+
+set -e
+
+PLOTTER=$(realpath "${1:-./plotter}")
+SMALL=10
+LARGE=1000
+MARGIN_KB=$((32 * 1024))
+
+if [ ! -x "$PLOTTER" ]; then
+  echo "memory.sh: no plotter at $PLOTTER (run make first)" >&2
+  exit 1
+fi
+if [ ! -x /usr/bin/time ]; then
+  echo "memory.sh: needs GNU time (/usr/bin/time)" >&2
+  exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# One file with LARGE samples of 20 bins, and the chi2 summary histograms
+cat > "$WORK/fixture.C" <<MACRO
+void fixture() {
+  TFile f("$WORK/nuiscomp.root", "RECREATE");
+  TH1D chi2("likelihood_hist", "", $LARGE, 0, $LARGE);
+  TH1D ndof("ndof_hist", "", $LARGE, 0, $LARGE);
+  for (int i=0; i<$LARGE; i++) {
+    TString s = TString::Format("Sample%d", i);
+    TH1D data(s + "_data", "", 20, 0, 2);
+    TH1D mc(s + "_MC", "", 20, 0, 2);
+    for (int b=1; b<=20; b++) {
+      data.SetBinContent(b, 1 + b + i % 7);
+      data.SetBinError(b, 0.5);
+      mc.SetBinContent(b, 1.1 + b + i % 5);
+    }
+    data.Write();
+    mc.Write();
+    chi2.GetXaxis()->SetBinLabel(i + 1, s);
+    chi2.SetBinContent(i + 1, 25);
+    ndof.GetXaxis()->SetBinLabel(i + 1, s);
+    ndof.SetBinContent(i + 1, 20);
+  }
+  chi2.Write();
+  ndof.Write();
+}
+MACRO
+(cd "$WORK" && root -l -b -q fixture.C > /dev/null)
+
+# Config with n plots, one per sample
+config() {
+  local n=$1
+  echo '{ "generators": [ { "filename": "'"$WORK/nuiscomp.root"'", "title": "Test", "color": 600 } ],'
+  echo '  "plots": ['
+  for ((i=0; i<n; i++)); do
+    [ $i -gt 0 ] && echo ','
+    echo -n '    { "sample": "Sample'$i'", "xrange": [0, 1.5] }'
+  done
+  echo ' ] }'
+}
+
+# Peak RSS in kB of a plotter run over n plots
+peak() {
+  local n=$1
+  local dir="$WORK/run$n"
+  mkdir -p "$dir"
+  config $n > "$dir/config.json"
+  (cd "$dir" && /usr/bin/time -v "$PLOTTER" -c config.json -F -o data > plotter.log 2> time.log) || {
+    echo "memory.sh: plotter failed on $n plots" >&2
+    tail "$dir/plotter.log" "$dir/time.log" >&2
+    exit 1
+  }
+  local files=$(ls "$dir"/*.data.json | wc -l)
+  if [ "$files" -ne "$n" ]; then
+    echo "memory.sh: expected $n plots, got $files" >&2
+    exit 1
+  fi
+  sed -n 's/.*Maximum resident set size (kbytes): //p' "$dir/time.log"
+}
+
+rss_small=$(peak $SMALL)
+rss_large=$(peak $LARGE)
+echo "peak RSS: $SMALL plots ${rss_small} kB, $LARGE plots ${rss_large} kB (margin ${MARGIN_KB} kB)"
+
+if [ "$rss_large" -gt $((rss_small + MARGIN_KB)) ]; then
+  echo "memory.sh: FAILED, peak memory grows with the number of plots" >&2
+  exit 1
+fi
+echo "memory.sh: passed"